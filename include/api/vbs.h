@@ -0,0 +1,164 @@
+#ifndef VBS_API_H
+#define VBS_API_H
+
+/*
+ * C API of libvbs, for embedding the planner without files or processes.
+ *
+ * A planner works on an occupancy grid and keeps the buffers of the solver
+ * between calls. Coordinates are cells of the grid, x in [0, nx) and y in
+ * [0, ny), and are never flipped. Grids written by the planner are row-major,
+ * cell (x, y) at index x + y * nx. Every call returns a vbs_status, no
+ * exception crosses the API. A planner may be used by one thread at a time,
+ * different planners are independent.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#if defined(VBS_BUILDING_LIBRARY)
+#define VBS_API __declspec(dllexport)
+#else
+#define VBS_API __declspec(dllimport)
+#endif
+#else
+#define VBS_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct vbs_planner vbs_planner;
+
+typedef enum vbs_status {
+  VBS_OK = 0,
+  // A pointer is null, a cell is out of the grid, a start or goal is
+  // occupied or a size is 0
+  VBS_INVALID_ARGUMENT = 1,
+  // The goal could not be reached, see max_iterations and
+  // visibility_threshold
+  VBS_NO_PATH = 2,
+  // The path does not fit the buffer, the required size is still reported
+  VBS_BUFFER_TOO_SMALL = 3,
+  // Memory for the buffers of the planner could not be allocated. The
+  // planner is still valid, its results of the failed call are not.
+  VBS_OUT_OF_MEMORY = 4,
+  // Any other failure inside the planner, e.g. a thread that could not be
+  // started
+  VBS_INTERNAL_ERROR = 5
+} vbs_status;
+
+typedef struct vbs_options {
+  // Visibility from which a cell counts as seen, in (0, 1)
+  double visibility_threshold;
+  // Light sources a solve may place before giving up
+  size_t max_iterations;
+  // Threads of the sweeps, 0 for all hardware threads
+  size_t threads;
+  // Only convex obstacle corners are pivot candidates when non-zero
+  int corner_pivots;
+  // Range of the light sources in cells, 0 for the whole grid
+  double visibility_radius;
+  // Visibility is scaled by exp(-decay * d) at distance d, 0 for none
+  double visibility_decay;
+} vbs_options;
+
+typedef struct vbs_cell_update {
+  uint32_t x;
+  uint32_t y;
+  // Non-zero if the cell becomes free
+  int free;
+} vbs_cell_update;
+
+// Version of the API, bumped on incompatible changes
+VBS_API int vbs_api_version(void);
+
+// Fill options with the defaults of vbs::Config
+VBS_API void vbs_default_options(vbs_options *options);
+
+// Message of a status
+VBS_API const char *vbs_status_string(vbs_status status);
+
+// 64-bit words per row of a bit-packed grid of nx columns
+VBS_API size_t vbs_words_per_row(size_t nx);
+
+/*
+ * Create a planner on a bit-packed occupancy owned by the caller, used in
+ * place without a copy. Row y holds vbs_words_per_row(nx) words, bit x % 64
+ * of word x / 64 being set for a free cell (x, y). The words must outlive the
+ * planner, and writes to them must be followed by
+ * vbs_occupancy_changed(). options may be null for the defaults. Returns
+ * null on invalid arguments or if the planner could not be created.
+ */
+VBS_API vbs_planner *vbs_create_view(uint64_t *words, size_t nx, size_t ny,
+                                     const vbs_options *options);
+
+/*
+ * Create a planner on an occupancy of one byte per cell, packed into the
+ * planner one bit per cell. Cell (x, y) is cells[x + y * stride] and is free
+ * if it is not 0. Returns null on invalid arguments or if the planner could
+ * not be created.
+ */
+VBS_API vbs_planner *vbs_create(const uint8_t *cells, size_t nx, size_t ny,
+                                size_t stride, const vbs_options *options);
+
+VBS_API void vbs_destroy(vbs_planner *planner);
+
+// Dimensions of the grid of a planner
+VBS_API vbs_status vbs_size(const vbs_planner *planner, size_t *nx,
+                            size_t *ny);
+
+// The words of a view were written by the caller
+VBS_API vbs_status vbs_occupancy_changed(vbs_planner *planner);
+
+// Change the occupancy of cells, written through to the words of a view
+VBS_API vbs_status vbs_update_cells(vbs_planner *planner,
+                                    const vbs_cell_update *updates,
+                                    size_t count);
+
+/*
+ * Find a path from start to goal. The cells of the path, start and goal
+ * included, are written to path as x0, y0, x1, y1, ... if capacity cells fit.
+ * path_size receives the number of cells and length the length of the path,
+ * either may be null. path may be null with a capacity of 0 to only get the
+ * size and length.
+ */
+VBS_API vbs_status vbs_solve(vbs_planner *planner, int32_t start_x,
+                             int32_t start_y, int32_t goal_x, int32_t goal_y,
+                             int32_t *path, size_t capacity,
+                             size_t *path_size, double *length);
+
+/*
+ * Grids of the last vbs_solve(), nx * ny cells each: the global visibility,
+ * and the index along the light sources of the solve of the one each cell
+ * came from.
+ */
+VBS_API vbs_status vbs_global_visibility(const vbs_planner *planner,
+                                         double *visibility);
+VBS_API vbs_status vbs_came_from(const vbs_planner *planner,
+                                 uint64_t *came_from);
+
+/*
+ * Light sources of the last vbs_solve(), in the order of the vbs_came_from()
+ * indices, written as x0, y0, x1, y1, ... if capacity sources fit. count
+ * receives the number of sources.
+ */
+VBS_API vbs_status vbs_light_sources(const vbs_planner *planner,
+                                     int32_t *sources, size_t capacity,
+                                     size_t *count);
+
+// Visibility of every cell from a light source, nx * ny cells
+VBS_API vbs_status vbs_visibility(vbs_planner *planner, int32_t x, int32_t y,
+                                  double *visibility);
+
+// Visibility of cell b from light source a, without sweeping the grid
+VBS_API vbs_status vbs_visibility_between(vbs_planner *planner, int32_t ax,
+                                          int32_t ay, int32_t bx, int32_t by,
+                                          double *visibility);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VBS_API_H
@@ -0,0 +1,166 @@
+#ifndef CORNERINDEX_H
+#define CORNERINDEX_H
+
+#include "environment/occupancyGrid.h"
+#include "parser/parser.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vbs {
+
+/*!
+ * @brief Free cells at the convex corners of the obstacles, one bit per cell.
+ *
+ * A free cell is a corner cell if, for one of the four diagonal directions,
+ * the diagonal neighbour is occupied while both neighbours next to it along x
+ * and y are free: the cell then sits just outside a convex corner, where
+ * shortest paths around the obstacle bend. Cells out of the grid count as
+ * free, so the borders of the map make no corners. The cells are computed a
+ * 64-bit word of a row at a time.
+ */
+class CornerIndex {
+
+public:
+  using size_t = std::size_t;
+  using word = OccupancyGrid::word;
+
+  // Extract the corner cells of a whole occupancy grid
+  void build(const OccupancyGrid &occupancy) {
+    corners_.resize(occupancy.nx(), occupancy.ny(), false);
+    count_ = 0;
+    extract(occupancy, 0, occupancy.ny());
+  }
+
+  /*!
+   * @brief The occupancy of some cells of row y changed, extract again the
+   * corner cells of the rows next to them.
+   * @param [in] occupancy Occupancy grid the index was built from.
+   * @param [in] y Changed row.
+   */
+  void update(const OccupancyGrid &occupancy, const size_t y) {
+    extract(occupancy, y > 0 ? y - 1 : 0, y + 2);
+  }
+
+  // true if cell (x, y) is a corner cell
+  inline bool isCorner(const size_t x, const size_t y) const {
+    return corners_.get(x, y);
+  }
+
+  /*!
+   * @brief Corner cells x, ..., x + n - 1 of row y as the low n bits of the
+   * result, see OccupancyGrid::bits().
+   */
+  inline std::uint32_t bits(const size_t y, const size_t x,
+                            const size_t n) const {
+    return OccupancyGrid::bits(corners_.row(y), x, n);
+  }
+
+  // Number of corner cells
+  inline size_t count() const { return count_; }
+
+  // Corner cells in row-major order
+  std::vector<point> cells() const {
+    std::vector<point> cells;
+    cells.reserve(count_);
+    for (size_t y = 0; y < corners_.ny(); ++y) {
+      const word *row = corners_.row(y);
+      for (size_t w = 0; w < corners_.wordsPerRow(); ++w) {
+        for (word bits = row[w]; bits != 0; bits &= bits - 1) {
+          const size_t x =
+              w * OccupancyGrid::wordBits + std::countr_zero(bits);
+          cells.push_back({static_cast<int>(x), static_cast<int>(y)});
+        }
+      }
+    }
+    return cells;
+  }
+
+private:
+  // Corner cells of rows [yBegin, yEnd), clamped to the grid
+  void extract(const OccupancyGrid &occupancy, const size_t yBegin,
+               const size_t yEnd) {
+    const size_t ny = occupancy.ny();
+    const size_t words = occupancy.wordsPerRow();
+    // Free cells of the rows below, at and above row y, with a free word on
+    // each side. Rows out of the grid stay free.
+    below_.assign(words + 2, ~word(0));
+    here_.assign(words + 2, ~word(0));
+    above_.assign(words + 2, ~word(0));
+    const size_t y0 = std::min(yBegin, ny);
+    const size_t y1 = std::min(yEnd, ny);
+    if (y0 > 0) {
+      load(occupancy, y0 - 1, below_);
+    }
+    if (y0 < y1) {
+      load(occupancy, y0, here_);
+    }
+    for (size_t y = y0; y < y1; ++y) {
+      if (y + 1 < ny) {
+        load(occupancy, y + 1, above_);
+      } else {
+        std::fill(above_.begin(), above_.end(), ~word(0));
+      }
+      word *row = corners_.row(y);
+      for (size_t w = 0; w < words; ++w) {
+        count_ -= std::popcount(row[w]);
+        row[w] = cornersOf(w + 1) & valid(occupancy.nx(), w);
+        count_ += std::popcount(row[w]);
+      }
+      below_.swap(here_);
+      here_.swap(above_);
+    }
+  }
+
+  // Free cells of row y into words 1 to wordsPerRow of a padded row
+  static void load(const OccupancyGrid &occupancy, const size_t y,
+                   std::vector<word> &padded) {
+    const word *row = occupancy.row(y);
+    const size_t words = occupancy.wordsPerRow();
+    std::copy(row, row + words, padded.begin() + 1);
+    padded[words] |= ~valid(occupancy.nx(), words - 1);
+  }
+
+  // Mask of the cells of word w that are in a row of nx cells
+  static inline word valid(const size_t nx, const size_t w) {
+    const size_t end = nx - w * OccupancyGrid::wordBits;
+    return end >= OccupancyGrid::wordBits ? ~word(0)
+                                          : (word(1) << end) - 1;
+  }
+
+  // Bit x of the result is cell x + 1 of a padded row, or cell x - 1
+  static inline word next(const std::vector<word> &r, const size_t w) {
+    return (r[w] >> 1) | (r[w + 1] << (OccupancyGrid::wordBits - 1));
+  }
+  static inline word previous(const std::vector<word> &r, const size_t w) {
+    return (r[w] << 1) | (r[w - 1] >> (OccupancyGrid::wordBits - 1));
+  }
+
+  // Corner cells of word w of the padded middle row
+  inline word cornersOf(const size_t w) const {
+    const word left = previous(here_, w);
+    const word right = next(here_, w);
+    const word up = above_[w];
+    const word down = below_[w];
+    const word corners = (left & up & ~previous(above_, w)) |
+                         (right & up & ~next(above_, w)) |
+                         (left & down & ~previous(below_, w)) |
+                         (right & down & ~next(below_, w));
+    return here_[w] & corners;
+  }
+
+  // One bit per cell, set for corner cells
+  OccupancyGrid corners_;
+  size_t count_ = 0;
+  // Padded rows around the row being extracted, kept for their storage
+  std::vector<word> below_;
+  std::vector<word> here_;
+  std::vector<word> above_;
+};
+
+} // namespace vbs
+
+#endif // CORNERINDEX_H
@@ -1,17 +1,26 @@
 #ifndef ENVIRONMENT_H
 #define ENVIRONMENT_H
 
+#include "environment/cornerIndex.h"
 #include "environment/field.h"
+#include "environment/goalDistance.h"
+#include "environment/gridWriter.h"
+#include "environment/occupancyGrid.h"
 #include "parser/parser.h"
 
 #include <filesystem>
 #include <memory>
+#include <string>
 #include <vector>
 
-#include <SFML/Graphics.hpp>
-
 namespace vbs {
 
+// New occupancy of one cell of the map
+struct CellUpdate {
+  size_t x, y;
+  bool free;
+};
+
 // Environment simulator
 class environment {
 public:
@@ -21,6 +30,16 @@ public:
    */
   explicit environment(Config &config);
 
+  /*!
+   * Constructor.
+   * @brief Initialize an environment on an existing occupancy, e.g. a view
+   * of a buffer owned by an embedding application. Nothing is generated,
+   * loaded or saved.
+   * @param [in] config Configuration, its mode is ignored.
+   * @param [in] occupancy Occupancy, shared with the environment.
+   */
+  environment(Config &config, std::shared_ptr<OccupancyGrid> occupancy);
+
   /*!
    * @brief Generate a random new environment on request. Overwrites previously
    * generated environment.
@@ -44,24 +63,60 @@ public:
   void generateNewEnvironmentFromSettings();
 
   /*!
-   * @brief Loads image data using SFML. Overwrites previously generated
-   * environment.
+   * @brief Loads image data, see vbs::loadImage(). Overwrites previously
+   * generated environment.
    * @param [in] filename Filename.
    */
   void loadImage(const std::string &filename);
 
+  /*!
+   * @brief Change the occupancy of a few cells, e.g. a door opening or a
+   * pallet moving. The occupancy is shared, so the solvers of this
+   * environment see the change at once and can repair their visibility with
+   * visibilityBasedSolver::repairVisibility().
+   * @param [in] updates Cells to change, cells out of the grid are skipped.
+   */
+  void updateCells(const std::vector<CellUpdate> &updates);
+
+  /*!
+   * @brief The words of the occupancy were written directly, e.g. in a
+   * buffer it views: mark it changed and extract the corners again.
+   */
+  void occupancyChanged();
+
+  /*!
+   * @brief Loads a map written as text, line x holding the cells of column x,
+   * see loadTextMap(). Overwrites previously generated environment.
+   * @param [in] filename Filename.
+   */
   void loadMaps(const std::string &filename);
-  std::vector<float> stringToFloatVector(const std::string &str,
-                                         char delimiter);
+
+  /*!
+   * @brief Loads a binary PBM or PGM map, memory mapped and packed in place,
+   * see vbs::loadNetpbm(). Overwrites previously generated environment.
+   * @param [in] filename Filename.
+   */
+  void loadNetpbm(const std::string &filename);
+
+  /*!
+   * @brief Loads a map with the loader of its extension: .pbm and .pgm with
+   * loadNetpbm(), .txt with loadMaps() and any other with loadImage().
+   * @param [in] filename Filename.
+   */
+  void loadMap(const std::string &filename);
 
   // Get visibility field shared pointer.
   inline const auto &getVisibilityField() const {
     return sharedVisibilityField_;
   };
-  // Get speed field shared pointer.
-  inline const auto &getSpeedField() const { return sharedSpeedField_; };
   // Get parsed configuration.
   inline const auto &getConfig() const { return sharedConfig_; };
+  // Get goal distance cache shared pointer.
+  inline const auto &getGoalDistanceCache() const {
+    return sharedGoalDistance_;
+  };
+  // Get corner index shared pointer, kept up to date with the occupancy.
+  inline const auto &getCornerIndex() const { return sharedCornerIndex_; };
 
   // Deconstructor
   ~environment() = default;
@@ -70,21 +125,22 @@ private:
   size_t ny_;
   size_t nx_;
   size_t size_;
-  double speedValue_ = 2.0;
   int seedValue_ = 1;
 
-  // Shared pointer to a Field object of type double that has map occupancy
-  // values.
-  std::shared_ptr<Field<double>> sharedVisibilityField_;
-  std::shared_ptr<Field<double>> sharedSpeedField_;
+  // Shared pointer to the map occupancy, one bit per cell.
+  std::shared_ptr<OccupancyGrid> sharedVisibilityField_;
 
   // Shared pointer to configuration
   std::shared_ptr<Config> sharedConfig_;
-  // Unique pointer to image holder
-  std::unique_ptr<sf::Image> uniqueLoadedImage_;
+  // Goal distance fields, shared by the solvers of this environment
+  std::shared_ptr<GoalDistanceCache> sharedGoalDistance_;
+  // Convex obstacle corners of the map, shared by the solvers
+  std::shared_ptr<CornerIndex> sharedCornerIndex_;
 
   void saveEnvironment();
   void resetEnvironment();
+  // Extract the corners of the current map into the corner index
+  void indexCorners();
 };
 
 } // namespace vbs
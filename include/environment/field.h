@@ -1,25 +1,61 @@
 #ifndef FIELD_H
 #define FIELD_H
 
+#include "environment/memoryResource.h"
+
+#include <algorithm>
 #include <cstddef>
-#include <memory>
+#include <memory_resource>
+#include <type_traits>
+#include <utility>
 
 namespace vbs {
 
+/*!
+ * @brief Grid of nx by ny values, row-major. The cells are fieldAlignment
+ * aligned and come from a memory resource fixed when the field is built,
+ * fieldResource() unless one is given.
+ */
 template <typename T> class Field {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "cells are filled and copied in bulk");
 
 public:
   using size_t = std::size_t;
-  Field() : nx_(0), ny_(0), size_(0), data_(nullptr) {}
+  Field() : Field(nullptr) {}
+  explicit Field(std::pmr::memory_resource *resource)
+      : nx_(0), ny_(0), size_(0), data_(nullptr),
+        resource_(resource ? resource : fieldResource()) {}
+
+  explicit Field(const size_t nx, const size_t ny, const T default_value,
+                 std::pmr::memory_resource *resource = nullptr)
+      : Field(resource) {
+    resize(nx, ny, default_value);
+  }
 
-  explicit Field(const size_t nx, const size_t ny, const T default_value)
-      : nx_(nx), ny_(ny), size_(nx * ny) {
-    data_ = std::make_unique<T[]>(size_);
-    for (size_t i = 0; i < size_; ++i) {
-      data_[i] = default_value;
+  Field(const Field &) = delete;
+  Field &operator=(const Field &) = delete;
+
+  // The storage moves with its resource
+  Field(Field &&other) noexcept
+      : nx_(std::exchange(other.nx_, 0)), ny_(std::exchange(other.ny_, 0)),
+        size_(std::exchange(other.size_, 0)),
+        data_(std::exchange(other.data_, nullptr)), resource_(other.resource_) {
+  }
+  Field &operator=(Field &&other) noexcept {
+    if (this != &other) {
+      release();
+      nx_ = std::exchange(other.nx_, 0);
+      ny_ = std::exchange(other.ny_, 0);
+      size_ = std::exchange(other.size_, 0);
+      data_ = std::exchange(other.data_, nullptr);
+      resource_ = other.resource_;
     }
+    return *this;
   }
 
+  ~Field() { release(); }
+
   void set(const size_t x, const size_t y, const T value) {
     data_[x + y * nx_] = value;
   }
@@ -28,27 +64,64 @@ public:
   inline T& operator()(size_t x, size_t y) { return data_[x + y * nx_]; }
   inline const T& operator()(size_t x, size_t y) const { return data_[x + y * nx_]; }
 
+  // Raw row-major storage, x + y * nx
+  inline T *data() { return data_; }
+  inline const T *data() const { return data_; }
+
   size_t nx() const { return nx_; }
   size_t ny() const { return ny_; }
   size_t size() const { return size_; }
 
-  void reset() { data_ = std::make_unique<T[]>(size_); }
+  // Set every cell to zero, keeping the storage
+  void reset() { fill(T()); }
+
+  // Set every cell to value, keeping the storage
+  void fill(const T value) { std::fill_n(data_, size_, value); }
+
+  // Copy another field, keeping the storage if the sizes match
+  void assign(const Field &other) {
+    reserve(other.size_);
+    nx_ = other.nx_;
+    ny_ = other.ny_;
+    std::copy_n(other.data_, size_, data_);
+  }
 
+  // Resize and set every cell to default_value, keeping the storage if the
+  // size matches
   void resize(const size_t nx, const size_t ny, const T default_value) {
+    reserve(nx * ny);
     nx_ = nx;
     ny_ = ny;
-    size_ = nx * ny;
-    data_ = std::make_unique<T[]>(size_);
-    for (size_t i = 0; i < size_; ++i) {
-      data_[i] = default_value;
-    }
+    fill(default_value);
   }
 
 private:
+  // Storage of exactly size cells, contents unspecified
+  void reserve(const size_t size) {
+    if (size == size_ && data_ != nullptr) {
+      return;
+    }
+    release();
+    if (size > 0) {
+      data_ = static_cast<T *>(
+          resource_->allocate(size * sizeof(T), fieldAlignment));
+    }
+    size_ = size;
+  }
+
+  void release() {
+    if (data_ != nullptr) {
+      resource_->deallocate(data_, size_ * sizeof(T), fieldAlignment);
+      data_ = nullptr;
+    }
+    size_ = 0;
+  }
+
   size_t nx_;
   size_t ny_;
   size_t size_;
-  std::unique_ptr<T[]> data_;
+  T *data_;
+  std::pmr::memory_resource *resource_;
 };
 
 } // namespace vbs
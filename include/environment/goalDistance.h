@@ -0,0 +1,65 @@
+#ifndef GOALDISTANCE_H
+#define GOALDISTANCE_H
+
+#include "environment/field.h"
+#include "parser/parser.h"
+
+#include <cmath>
+#include <memory>
+#include <mutex>
+
+namespace vbs {
+
+// Euclidean distance of every cell of a grid to a goal. The field does not
+// depend on obstacles, so the one of the last goal is kept and queries with
+// the same goal and dimensions share it instead of rebuilding it. A new goal
+// is written over the field in place once no solver holds it any more.
+class GoalDistanceCache {
+
+public:
+  using size_t = std::size_t;
+
+  /*!
+   * @brief Distance field of a goal, built on the first request.
+   * @param [in] goal Goal cell.
+   * @param [in] nx Number of columns.
+   * @param [in] ny Number of rows.
+   */
+  std::shared_ptr<const Field<double>> get(const point &goal, const size_t nx,
+                                           const size_t ny) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (field_ && goal_ == goal && field_->nx() == nx && field_->ny() == ny) {
+      return field_;
+    }
+    // Only get() hands the field out and it holds the lock, so a field no one
+    // else holds cannot be taken while it is written
+    std::shared_ptr<Field<double>> field = field_;
+    if (!field || field.use_count() > 2 || field->nx() != nx ||
+        field->ny() != ny) {
+      field = std::make_shared<Field<double>>(nx, ny, 0.0);
+    }
+    for (size_t y = 0; y < ny; ++y) {
+      for (size_t x = 0; x < nx; ++x) {
+        (*field)(x, y) = distance(x, y, goal);
+      }
+    }
+    goal_ = goal;
+    field_ = std::move(field);
+    return field_;
+  }
+
+  // Distance of cell (x, y) to the goal, as the solver's eval_d computes it
+  static inline double distance(const int x, const int y, const point &goal) {
+    return sqrt((double)(x - goal.first) * (x - goal.first) +
+                (y - goal.second) * (y - goal.second));
+  }
+
+private:
+  std::mutex mutex_;
+  point goal_;
+  std::shared_ptr<Field<double>> field_;
+};
+
+} // namespace vbs
+
+#endif // GOALDISTANCE_H
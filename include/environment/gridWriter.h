@@ -0,0 +1,104 @@
+#ifndef GRIDWRITER_H
+#define GRIDWRITER_H
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+namespace vbs {
+
+// Format of the grids written to the output directory, see Config
+enum class OutputFormat {
+  // One line per row of values separated by spaces
+  text = 0,
+  // NumPy .npy array of shape (rows, columns), written in bulk
+  npy = 1
+};
+
+/*!
+ * @brief Write a grid of nx by ny values, one row of the file per row y of
+ * the grid, to stem + ".txt" or stem + ".npy".
+ * @param [in] stem Path of the file without its extension.
+ * @param [in] format Output format.
+ * @param [in] nx Number of columns.
+ * @param [in] ny Number of rows.
+ * @param [in] flip Write the rows from y = ny - 1 down to 0.
+ * @param [in] value value(x, y) is the value of cell (x, y), written as V.
+ * V is an arithmetic type or bool.
+ * @return false if the file could not be written.
+ */
+template <typename V, typename Value>
+bool writeGrid(const std::string &stem, const OutputFormat format,
+               const size_t nx, const size_t ny, const bool flip,
+               Value &&value) {
+  static_assert(std::is_arithmetic_v<V>);
+  const std::string path =
+      stem + (format == OutputFormat::npy ? ".npy" : ".txt");
+  std::ios::openmode mode = std::ios::out | std::ios::trunc;
+  if (format == OutputFormat::npy) {
+    mode |= std::ios::binary;
+  }
+  std::ofstream of(path, mode);
+  if (!of.is_open()) {
+    std::cerr << "Failed to open output file " << path << std::endl;
+    return false;
+  }
+
+  if (format == OutputFormat::text) {
+    std::ostream &os = of;
+    for (size_t r = 0; r < ny; ++r) {
+      const size_t y = flip ? ny - 1 - r : r;
+      for (size_t x = 0; x < nx; ++x) {
+        os << static_cast<V>(value(x, y)) << " ";
+      }
+      os << "\n";
+    }
+  } else {
+    // Version 1.0 header: magic, version, header length and a dict padded
+    // with spaces so the data starts on a multiple of 64 bytes
+    const char order = sizeof(V) == 1                             ? '|'
+                       : std::endian::native == std::endian::little ? '<'
+                                                                    : '>';
+    const char kind = std::is_same_v<V, bool>     ? 'b'
+                      : std::is_floating_point_v<V> ? 'f'
+                      : std::is_signed_v<V>         ? 'i'
+                                                    : 'u';
+    std::string header = "{'descr': '" + std::string(1, order) + kind +
+                         std::to_string(sizeof(V)) +
+                         "', 'fortran_order': False, 'shape': (" +
+                         std::to_string(ny) + ", " + std::to_string(nx) +
+                         "), }";
+    const size_t preamble = 10;
+    header.append(63 - (preamble + header.size()) % 64, ' ');
+    header += '\n';
+    const std::uint16_t length = static_cast<std::uint16_t>(header.size());
+    of.write("\x93NUMPY\x01\x00", 8);
+    const char lengthBytes[2] = {static_cast<char>(length & 0xff),
+                                 static_cast<char>(length >> 8)};
+    of.write(lengthBytes, 2);
+    of.write(header.data(), header.size());
+    // Not a vector, which packs bools
+    auto row = std::make_unique<V[]>(nx);
+    for (size_t r = 0; r < ny; ++r) {
+      const size_t y = flip ? ny - 1 - r : r;
+      for (size_t x = 0; x < nx; ++x) {
+        row[x] = static_cast<V>(value(x, y));
+      }
+      of.write(reinterpret_cast<const char *>(row.get()), nx * sizeof(V));
+    }
+  }
+  if (!of) {
+    std::cerr << "Failed to write output file " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+} // namespace vbs
+
+#endif // GRIDWRITER_H
@@ -0,0 +1,87 @@
+#ifndef MAPLOADER_H
+#define MAPLOADER_H
+
+#include "environment/occupancyGrid.h"
+#include "solver/threadPool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace vbs {
+
+// Read-only view of a whole file. The file is memory mapped where the
+// platform allows it, and read into memory otherwise.
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile() { close(); }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  /*!
+   * @brief Map a file, releasing the previous one.
+   * @param [in] filename Filename.
+   * @return false if the file could not be opened or mapped.
+   */
+  bool open(const std::string &filename);
+  void close();
+
+  inline const char *data() const { return data_; }
+  inline std::size_t size() const { return size_; }
+
+private:
+  const char *data_ = nullptr;
+  std::size_t size_ = 0;
+  // Set when the file is mapped, data_ points into buffer_ otherwise
+  bool mapped_ = false;
+  std::unique_ptr<char[]> buffer_;
+};
+
+/*!
+ * @brief Pack rows of 8-bit pixels into an occupancy grid, a pixel being free
+ * if its first channel equals freeValue. The grid keeps its dimensions and
+ * the rows are split between the threads of the pool.
+ * @param [in] pixels Row-major pixels, channels bytes each, row y of the
+ * pixels going to row y of the grid.
+ * @param [in] channels Bytes per pixel, e.g. 1 for gray and 4 for RGBA.
+ * @param [in] freeValue Value of the free pixels.
+ * @param [out] occupancy Occupancy grid.
+ * @param [in] pool Threads.
+ */
+void packPixels(const std::uint8_t *pixels, std::size_t channels,
+                std::uint8_t freeValue, OccupancyGrid &occupancy,
+                ThreadPool &pool);
+
+/*!
+ * @brief Load a binary PBM (P4) or PGM (P5) map. PBM bits set to 1 are
+ * occupied, PGM pixels are free if they equal the maximum gray value of the
+ * file. The file is mapped and packed in place, row y of the file being row
+ * y of the grid.
+ * @param [in] filename Filename.
+ * @param [out] occupancy Occupancy grid, resized to the map.
+ * @param [in] pool Threads.
+ * @return false if the file could not be read or is not a binary PBM/PGM.
+ */
+bool loadNetpbm(const std::string &filename, OccupancyGrid &occupancy,
+                ThreadPool &pool);
+
+/*!
+ * @brief Load a map written as text, line x holding the values of cells
+ * (x, 0) to (x, ny - 1) separated by spaces, non-zero values being free. The
+ * lines are parsed in parallel, in blocks of 64 so that the threads never
+ * write the same word of the grid. Blank lines are skipped.
+ * @param [in] filename Filename.
+ * @param [out] occupancy Occupancy grid, resized to the map.
+ * @param [in] pool Threads.
+ * @return false if the file could not be read, a value could not be parsed
+ * or the lines do not all hold the same number of values.
+ */
+bool loadTextMap(const std::string &filename, OccupancyGrid &occupancy,
+                 ThreadPool &pool);
+
+} // namespace vbs
+
+#endif // MAPLOADER_H
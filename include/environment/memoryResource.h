@@ -0,0 +1,60 @@
+#ifndef MEMORYRESOURCE_H
+#define MEMORYRESOURCE_H
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace vbs {
+
+// Alignment of the cells of a Field: a cache line, and the widest SIMD load
+inline constexpr std::size_t fieldAlignment = 64;
+
+/*!
+ * @brief Memory resource backing large blocks with transparent huge pages,
+ * so that grids of millions of cells take few TLB entries and fault in 2 MiB
+ * at a time. Blocks of at least hugePageSize bytes are mapped 2 MiB aligned
+ * and advised for huge pages, smaller ones come from upstream. Where huge
+ * pages cannot be requested, large blocks are still 2 MiB aligned.
+ */
+class HugePageResource : public std::pmr::memory_resource {
+public:
+  static constexpr std::size_t hugePageSize = std::size_t(2) << 20;
+
+  /*!
+   * Constructor.
+   * @param [in] upstream Resource of the blocks smaller than a huge page.
+   */
+  explicit HugePageResource(
+      std::pmr::memory_resource *upstream = std::pmr::new_delete_resource())
+      : upstream_(upstream) {}
+
+private:
+  void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+  void do_deallocate(void *p, std::size_t bytes,
+                     std::size_t alignment) override;
+  bool do_is_equal(
+      const std::pmr::memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+
+  std::pmr::memory_resource *upstream_;
+};
+
+// Huge page resource shared by the process
+std::pmr::memory_resource *hugePageResource();
+
+// Resource of the fields built without one, new and delete unless set
+std::pmr::memory_resource *fieldResource();
+
+/*!
+ * @brief Set the resource of the fields built from now on. Fields keep the
+ * resource they were built with.
+ * @param [in] resource Resource, null for new and delete.
+ * @return The previous resource.
+ */
+std::pmr::memory_resource *
+setFieldResource(std::pmr::memory_resource *resource);
+
+} // namespace vbs
+
+#endif // MEMORYRESOURCE_H
@@ -0,0 +1,205 @@
+#ifndef OCCUPANCYGRID_H
+#define OCCUPANCYGRID_H
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace vbs {
+
+// Binary occupancy complement packed one bit per cell, set for free cells
+// and clear for occupied ones. Rows start on a 64-bit word so that a run of a
+// row can be read as a few words, bit x % 64 of word x / 64 being cell x.
+// The words are owned by the grid, or by the caller for a view().
+class OccupancyGrid {
+
+public:
+  using size_t = std::size_t;
+  using word = std::uint64_t;
+  static constexpr size_t wordBits = 64;
+
+  OccupancyGrid() : nx_(0), ny_(0), wordsPerRow_(0) {}
+
+  explicit OccupancyGrid(const size_t nx, const size_t ny, const bool free) {
+    resize(nx, ny, free);
+  }
+
+  void set(const size_t x, const size_t y, const bool free) {
+    word &w = row(y)[x / wordBits];
+    const word bit = word(1) << (x % wordBits);
+    w = free ? (w | bit) : (w & ~bit);
+    ++revision_;
+  }
+  // true if the cell is free
+  bool get(const size_t x, const size_t y) const {
+    return isFree(row(y), x);
+  }
+
+  size_t nx() const { return nx_; }
+  size_t ny() const { return ny_; }
+  size_t size() const { return nx_ * ny_; }
+  size_t wordsPerRow() const { return wordsPerRow_; }
+  // Changes on every set() and resize(), so that results derived from the
+  // grid can tell they are stale
+  size_t revision() const { return revision_; }
+  // Resident size of the grid in bytes
+  size_t bytes() const { return wordsPerRow_ * ny_ * sizeof(word); }
+
+  // Words of row y
+  inline word *row(const size_t y) { return data_ + y * wordsPerRow_; }
+  inline const word *row(const size_t y) const {
+    return data_ + y * wordsPerRow_;
+  }
+
+  // true if cell x of a row is free
+  static inline bool isFree(const word *row, const size_t x) {
+    return (row[x / wordBits] >> (x % wordBits)) & 1;
+  }
+
+  // true if every cell of a row in [xBegin, xEnd) is free
+  static bool isFree(const word *row, const size_t xBegin, const size_t xEnd) {
+    return forWords(row, xBegin, xEnd,
+                    [](word w, word mask) { return (w & mask) == mask; });
+  }
+
+  /*!
+   * @brief Free cells x, ..., x + n - 1 of a row as the low n bits of the
+   * result, bit k being cell x + k.
+   * @param [in] row Words of the row.
+   * @param [in] x First cell.
+   * @param [in] n Number of cells, at most 32 and within the row.
+   */
+  static inline std::uint32_t bits(const word *row, const size_t x,
+                                   const size_t n) {
+    const size_t w = x / wordBits;
+    const size_t shift = x % wordBits;
+    word v = row[w] >> shift;
+    if (shift + n > wordBits) {
+      v |= row[w + 1] << (wordBits - shift);
+    }
+    return static_cast<std::uint32_t>(v & ((word(1) << n) - 1));
+  }
+
+  /*!
+   * @brief Number of free cells of row y in [xBegin, xEnd).
+   */
+  size_t countFree(const size_t y, const size_t xBegin,
+                   const size_t xEnd) const {
+    size_t count = 0;
+    forWords(row(y), xBegin, xEnd, [&](word w, word mask) {
+      count += std::popcount(w & mask);
+      return true;
+    });
+    return count;
+  }
+
+  /*!
+   * @brief true if every cell of row y in [xBegin, xEnd) is free.
+   */
+  bool isRowFree(const size_t y, const size_t xBegin, const size_t xEnd) const {
+    return isFree(row(y), xBegin, xEnd);
+  }
+  bool isRowFree(const size_t y) const { return isRowFree(y, 0, nx_); }
+
+  /*!
+   * @brief true if every cell of row y in [xBegin, xEnd) is occupied.
+   */
+  bool isRowBlocked(const size_t y, const size_t xBegin,
+                    const size_t xEnd) const {
+    return forWords(row(y), xBegin, xEnd,
+                    [](word w, word mask) { return (w & mask) == 0; });
+  }
+  bool isRowBlocked(const size_t y) const { return isRowBlocked(y, 0, nx_); }
+
+  // Copy another grid, keeping the storage if the dimensions match
+  void assign(const OccupancyGrid &other) {
+    if (nx_ != other.nx_ || ny_ != other.ny_) {
+      nx_ = other.nx_;
+      ny_ = other.ny_;
+      wordsPerRow_ = other.wordsPerRow_;
+      storage_ = std::make_unique<word[]>(wordsPerRow_ * ny_);
+      data_ = storage_.get();
+    }
+    ++revision_;
+    std::copy_n(other.data_, wordsPerRow_ * ny_, data_);
+  }
+
+  /*!
+   * @brief Use words owned by the caller as the grid, without copying them.
+   * They must outlive the grid, and changes made to them directly must be
+   * followed by touch().
+   * @param [in] data Rows of wordsPerRow(nx) words each, laid out as in the
+   * grid.
+   * @param [in] nx Number of columns.
+   * @param [in] ny Number of rows.
+   */
+  void view(word *data, const size_t nx, const size_t ny) {
+    nx_ = nx;
+    ny_ = ny;
+    wordsPerRow_ = wordsPerRow(nx);
+    ++revision_;
+    storage_.reset();
+    data_ = data;
+  }
+
+  // Words per row of a grid of nx columns
+  static constexpr size_t wordsPerRow(const size_t nx) {
+    return (nx + wordBits - 1) / wordBits;
+  }
+
+  // Mark the grid as changed after its words were written directly
+  void touch() { ++revision_; }
+
+  void resize(const size_t nx, const size_t ny, const bool free) {
+    nx_ = nx;
+    ny_ = ny;
+    wordsPerRow_ = wordsPerRow(nx);
+    ++revision_;
+    storage_ = std::make_unique<word[]>(wordsPerRow_ * ny_);
+    data_ = storage_.get();
+    const word fill = free ? ~word(0) : word(0);
+    for (size_t i = 0; i < wordsPerRow_ * ny_; ++i) {
+      data_[i] = fill;
+    }
+  }
+
+private:
+  // Call op(word, mask) on the words covering [xBegin, xEnd) of a row, mask
+  // selecting the cells in range. Stops and returns false as soon as op does.
+  template <typename Op>
+  static bool forWords(const word *r, const size_t xBegin, const size_t xEnd,
+                       Op &&op) {
+    if (xEnd <= xBegin) {
+      return true;
+    }
+    const size_t first = xBegin / wordBits;
+    const size_t last = (xEnd - 1) / wordBits;
+    for (size_t w = first; w <= last; ++w) {
+      word mask = ~word(0);
+      if (w == first) {
+        mask &= ~word(0) << (xBegin % wordBits);
+      }
+      if (w == last && xEnd % wordBits != 0) {
+        mask &= ~word(0) >> (wordBits - xEnd % wordBits);
+      }
+      if (!op(r[w], mask)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  size_t nx_;
+  size_t ny_;
+  size_t wordsPerRow_;
+  size_t revision_ = 0;
+  // Words of the grid, storage_ or the words of a view
+  word *data_ = nullptr;
+  std::unique_ptr<word[]> storage_;
+};
+
+} // namespace vbs
+
+#endif // OCCUPANCYGRID_H
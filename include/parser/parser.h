@@ -25,6 +25,12 @@ struct Config {
   size_t max_iter = 100;
   double visibilityThreshold = 0.5;
   float lightStrength = 1;
+  size_t threads = 1;
+  bool cornerPivots = false;
+  double visibilityRadius = 0;
+  double visibilityDecay = 0;
+  // Back large grids with transparent huge pages, see HugePageResource
+  bool hugePages = false;
   bool timer = true;
   bool saveResults = true;
   bool saveLocalVisibility = true;
@@ -32,6 +38,10 @@ struct Config {
   bool saveLightSources = true;
   bool saveGlobalVisibility = true;
   bool saveVisibilityField = true;
+  // Format of the saved grids, 0 = text, 1 = npy (see OutputFormat)
+  int outputFormat = 0;
+  // Results waiting for the background writer, 0 to write synchronously
+  size_t writerQueue = 2;
   bool silent = false;
   int ballRadius = 5;
 };
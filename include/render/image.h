@@ -0,0 +1,114 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include "environment/occupancyGrid.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace vbs {
+
+// Colour of a pixel, 8 bits per channel
+struct Color {
+  uint8_t r = 0;
+  uint8_t g = 0;
+  uint8_t b = 0;
+  uint8_t a = 255;
+
+  constexpr Color() = default;
+  constexpr Color(const uint8_t red, const uint8_t green, const uint8_t blue,
+                  const uint8_t alpha = 255)
+      : r(red), g(green), b(blue), a(alpha) {}
+
+  static const Color Black, White, Red, Green, Blue, Yellow, Magenta, Cyan;
+};
+
+inline constexpr Color Color::Black{0, 0, 0};
+inline constexpr Color Color::White{255, 255, 255};
+inline constexpr Color Color::Red{255, 0, 0};
+inline constexpr Color Color::Green{0, 255, 0};
+inline constexpr Color Color::Blue{0, 0, 255};
+inline constexpr Color Color::Yellow{255, 255, 0};
+inline constexpr Color Color::Magenta{255, 0, 255};
+inline constexpr Color Color::Cyan{0, 255, 255};
+
+/*!
+ * @brief RGBA image drawn by the solver, row-major from the top row. It needs
+ * no library, only saveImage() and loadImage() encode and decode files.
+ */
+class Image {
+public:
+  using size_t = std::size_t;
+
+  void create(const size_t width, const size_t height,
+              const Color &color = Color::Black) {
+    width_ = width;
+    height_ = height;
+    pixels_.resize(width * height * 4);
+    for (size_t i = 0; i < pixels_.size(); i += 4) {
+      pixels_[i] = color.r;
+      pixels_[i + 1] = color.g;
+      pixels_[i + 2] = color.b;
+      pixels_[i + 3] = color.a;
+    }
+  }
+
+  // Take over RGBA pixels, width * height * 4 bytes
+  void create(const size_t width, const size_t height,
+              std::vector<uint8_t> &&pixels) {
+    width_ = width;
+    height_ = height;
+    pixels_ = std::move(pixels);
+  }
+
+  inline void setPixel(const size_t x, const size_t y, const Color &color) {
+    uint8_t *p = &pixels_[(y * width_ + x) * 4];
+    p[0] = color.r;
+    p[1] = color.g;
+    p[2] = color.b;
+    p[3] = color.a;
+  }
+
+  inline size_t width() const { return width_; }
+  inline size_t height() const { return height_; }
+  inline const uint8_t *getPixelsPtr() const { return pixels_.data(); }
+
+private:
+  size_t width_ = 0;
+  size_t height_ = 0;
+  std::vector<uint8_t> pixels_;
+};
+
+/*!
+ * @brief Image of an occupancy grid, free cells white and occupied cells
+ * black, with y = 0 at the bottom. Row y = 0 of the grid is left black.
+ * @param [in] occupancy Occupancy grid, set bits free.
+ * @return The image.
+ */
+Image occupancyImage(const OccupancyGrid &occupancy);
+
+/*!
+ * @brief Save an image. Built with SFML, the format follows the extension of
+ * filename. Without it, a binary PPM is written to filename with its extension
+ * replaced by .ppm.
+ * @param [in] image Image to save.
+ * @param [in] filename Path of the file.
+ * @return false if the file could not be written.
+ */
+bool saveImage(const Image &image, const std::string &filename);
+
+/*!
+ * @brief Load an image with SFML, any format it decodes. Without SFML it
+ * fails with a message, see loadNetpbm() for maps that need no library.
+ * @param [in] filename Path of the file.
+ * @param [out] image Loaded image.
+ * @return false if the image could not be loaded.
+ */
+bool loadImage(const std::string &filename, Image &image);
+
+} // namespace vbs
+
+#endif // IMAGE_H
@@ -0,0 +1,240 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace vbs {
+
+/*!
+ * @brief Just enough JSON for the query protocol of the planning server: a
+ * parsed value and the writing of numbers and strings. Strings keep their
+ * escapes other than \" and \\, which the protocol does not need.
+ */
+struct JsonValue {
+  using size_t = std::size_t;
+  enum class Kind { null, boolean, number, string, array, object };
+
+  Kind kind = Kind::null;
+  bool boolean = false;
+  double number = 0;
+  std::string string;
+  std::vector<JsonValue> array;
+  std::vector<std::pair<std::string, JsonValue>> object;
+
+  // Member of an object, null if there is none
+  const JsonValue *find(const std::string_view key) const {
+    for (const auto &[name, value] : object) {
+      if (name == key) {
+        return &value;
+      }
+    }
+    return nullptr;
+  }
+
+  bool isNumber() const { return kind == Kind::number; }
+
+  /*!
+   * @brief Parse a whole document.
+   * @param [in] text Document.
+   * @param [out] value Parsed value.
+   * @return false if the text is not one JSON value.
+   */
+  static bool parse(const std::string_view text, JsonValue &value) {
+    size_t p = 0;
+    if (!parseValue(text, p, value, 0)) {
+      return false;
+    }
+    skipSpace(text, p);
+    return p == text.size();
+  }
+
+private:
+  // Nesting accepted, the protocol needs 3
+  static constexpr int maxDepth = 16;
+
+  static void skipSpace(const std::string_view t, size_t &p) {
+    while (p < t.size() &&
+           (t[p] == ' ' || t[p] == '\t' || t[p] == '\r' || t[p] == '\n')) {
+      ++p;
+    }
+  }
+
+  static bool literal(const std::string_view t, size_t &p,
+                      const std::string_view word) {
+    if (t.substr(p, word.size()) != word) {
+      return false;
+    }
+    p += word.size();
+    return true;
+  }
+
+  static bool parseString(const std::string_view t, size_t &p,
+                          std::string &out) {
+    out.clear();
+    ++p;
+    while (p < t.size() && t[p] != '"') {
+      if (t[p] == '\\' && p + 1 < t.size()) {
+        ++p;
+        if (t[p] != '"' && t[p] != '\\') {
+          out += '\\';
+        }
+      }
+      out += t[p++];
+    }
+    if (p == t.size()) {
+      return false;
+    }
+    ++p;
+    return true;
+  }
+
+  static bool parseValue(const std::string_view t, size_t &p, JsonValue &v,
+                         const int depth) {
+    skipSpace(t, p);
+    if (p == t.size() || depth > maxDepth) {
+      return false;
+    }
+    v = JsonValue();
+    switch (t[p]) {
+    case 'n':
+      return literal(t, p, "null");
+    case 't':
+      v.kind = Kind::boolean;
+      v.boolean = true;
+      return literal(t, p, "true");
+    case 'f':
+      v.kind = Kind::boolean;
+      return literal(t, p, "false");
+    case '"':
+      v.kind = Kind::string;
+      return parseString(t, p, v.string);
+    case '[':
+      v.kind = Kind::array;
+      ++p;
+      skipSpace(t, p);
+      if (p < t.size() && t[p] == ']') {
+        ++p;
+        return true;
+      }
+      while (true) {
+        v.array.emplace_back();
+        if (!parseValue(t, p, v.array.back(), depth + 1)) {
+          return false;
+        }
+        skipSpace(t, p);
+        if (p < t.size() && t[p] == ',') {
+          ++p;
+        } else {
+          return p < t.size() && t[p++] == ']';
+        }
+      }
+    case '{':
+      v.kind = Kind::object;
+      ++p;
+      skipSpace(t, p);
+      if (p < t.size() && t[p] == '}') {
+        ++p;
+        return true;
+      }
+      while (true) {
+        skipSpace(t, p);
+        v.object.emplace_back();
+        if (p == t.size() || t[p] != '"' ||
+            !parseString(t, p, v.object.back().first)) {
+          return false;
+        }
+        skipSpace(t, p);
+        if (p == t.size() || t[p++] != ':' ||
+            !parseValue(t, p, v.object.back().second, depth + 1)) {
+          return false;
+        }
+        skipSpace(t, p);
+        if (p < t.size() && t[p] == ',') {
+          ++p;
+        } else {
+          return p < t.size() && t[p++] == '}';
+        }
+      }
+    default: {
+      v.kind = Kind::number;
+      const char *begin = t.data() + p;
+      const auto [next, ec] =
+          std::from_chars(begin, t.data() + t.size(), v.number);
+      if (ec != std::errc() || next == begin) {
+        return false;
+      }
+      p += next - begin;
+      return true;
+    }
+    }
+  }
+};
+
+// Append a number, in its shortest exact form, or null if it is not finite
+inline void appendJson(std::string &out, const double value) {
+  if (!std::isfinite(value)) {
+    out += "null";
+    return;
+  }
+  char buffer[32];
+  const auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  out.append(buffer, end);
+}
+
+// Append a string, quoted and escaped
+inline void appendJson(std::string &out, const std::string_view value) {
+  out += '"';
+  for (const char c : value) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+    }
+    out += c == '\n' ? ' ' : c;
+  }
+  out += '"';
+}
+
+// Append a parsed value, e.g. the id of a request echoed in its response
+inline void appendJson(std::string &out, const JsonValue &value) {
+  switch (value.kind) {
+  case JsonValue::Kind::null:
+    out += "null";
+    break;
+  case JsonValue::Kind::boolean:
+    out += value.boolean ? "true" : "false";
+    break;
+  case JsonValue::Kind::number:
+    appendJson(out, value.number);
+    break;
+  case JsonValue::Kind::string:
+    appendJson(out, std::string_view(value.string));
+    break;
+  case JsonValue::Kind::array:
+    out += '[';
+    for (std::size_t i = 0; i < value.array.size(); ++i) {
+      out += i > 0 ? "," : "";
+      appendJson(out, value.array[i]);
+    }
+    out += ']';
+    break;
+  case JsonValue::Kind::object:
+    out += '{';
+    for (std::size_t i = 0; i < value.object.size(); ++i) {
+      out += i > 0 ? "," : "";
+      appendJson(out, std::string_view(value.object[i].first));
+      out += ':';
+      appendJson(out, value.object[i].second);
+    }
+    out += '}';
+    break;
+  }
+}
+
+} // namespace vbs
+
+#endif // JSON_H
@@ -0,0 +1,98 @@
+#ifndef PLANNINGSERVER_H
+#define PLANNINGSERVER_H
+
+#include "environment/environment.h"
+#include "server/json.h"
+#include "solver/visibilityBasedSolver.h"
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace vbs {
+
+/*!
+ * @brief Resident planning server. The map and the buffers of the solver are
+ * kept between queries, so a query only pays for its own computation.
+ *
+ * Queries are JSON objects, one per line, answered by one line each in the
+ * order they came. A client can send many queries without waiting for the
+ * answers, responses are flushed whenever no more input is pending. Every
+ * query may carry an "id", echoed in its response, and an "op":
+ * - "solve": path from "start" to "goal", both [x, y]. Answers "length"
+ *   (null if there is no path), "path" as [[x, y], ...] and "us", the time
+ *   spent solving.
+ * - "visibility": visibility of the cells "targets", [[x, y], ...], from
+ *   light source "source", [x, y]. Answers "values".
+ * - "benchmark": "queries" solves between random free cells drawn from
+ *   "seed". Answers "queries", "found", "meanUs", "minUs" and "maxUs".
+ * - "quit": stop serving.
+ * Responses hold "ok", and "error" when it is false. Coordinates follow the
+ * start and end of settings.config, flipped in image mode.
+ */
+class PlanningServer {
+public:
+  /*!
+   * Constructor.
+   * @brief Serve queries on an environment with a resident solver.
+   * @param [in] env Environment reference.
+   * @param [in] solver Solver of the environment.
+   */
+  PlanningServer(environment &env, visibilityBasedSolver<> &solver);
+
+  /*!
+   * @brief Answer the queries of a stream until its end or a quit query.
+   * @param [in] in Queries.
+   * @param [out] out Responses.
+   */
+  void serve(std::istream &in, std::ostream &out);
+
+  /*!
+   * @brief Answer the queries of the clients of a local Unix socket, one
+   * connection after the other, until a quit query. A stale socket file at
+   * path is replaced.
+   * @param [in] path Path of the socket.
+   * @return false if the socket could not be set up.
+   */
+  bool serveSocket(const std::string &path);
+
+  /*!
+   * @brief Answer one query.
+   * @param [in] query Line of the query.
+   * @param [out] response Line of the response, without the newline,
+   * appended to.
+   */
+  void handle(std::string_view query, std::string &response);
+
+  // true once a quit query was answered
+  inline bool stopped() const { return stop_; }
+
+private:
+  // Read [x, y] into a cell of the grid, false if it is not in the grid
+  bool readCell(const JsonValue *value, point &cell) const;
+  void appendCell(std::string &out, const point &cell) const;
+
+  void solve(const JsonValue &query, std::string &response);
+  void visibility(const JsonValue &query, std::string &response);
+  void benchmark(const JsonValue &query, std::string &response);
+
+  // Answer the queries of one client until it disconnects
+  void serveConnection(int client);
+
+  visibilityBasedSolver<> &solver_;
+  std::shared_ptr<OccupancyGrid> occupancy_;
+  // Coordinates of the queries are flipped along y, as in image mode
+  bool flip_;
+  bool stop_ = false;
+
+  // Last query, and the path of the last solve kept for its storage
+  JsonValue query_;
+  std::vector<point> path_;
+};
+
+} // namespace vbs
+
+#endif // PLANNINGSERVER_H
@@ -0,0 +1,62 @@
+#ifndef ASYNCWRITER_H
+#define ASYNCWRITER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace vbs {
+
+// Background thread running output jobs in the order they were submitted, so
+// that writing results does not hold up the caller. At most depth jobs wait
+// at a time, submitting one more blocks until the oldest one has started.
+class AsyncWriter {
+public:
+  /*!
+   * Constructor.
+   * @brief Start the writer thread.
+   * @param [in] depth Number of jobs that can wait, 0 to run every job inline
+   * in submit() without a thread.
+   */
+  explicit AsyncWriter(std::size_t depth);
+  // Deconstructor, runs the waiting jobs and joins the thread
+  ~AsyncWriter();
+
+  AsyncWriter(const AsyncWriter &) = delete;
+  AsyncWriter &operator=(const AsyncWriter &) = delete;
+
+  /*!
+   * @brief Queue a job. It must own or copy what it writes, as the caller
+   * goes on at once.
+   * @param [in] job Job body.
+   */
+  void submit(std::function<void()> job);
+
+  // Wait until every job submitted so far has run
+  void flush();
+
+  inline std::size_t depth() const { return depth_; }
+
+private:
+  void work();
+
+  const std::size_t depth_;
+  std::thread thread_;
+  std::mutex mutex_;
+  // Signals a new job or stop_ to the thread
+  std::condition_variable wake_;
+  // Signals a job taken or finished to the callers
+  std::condition_variable done_;
+
+  // Guarded by mutex_
+  std::deque<std::function<void()>> jobs_;
+  bool busy_ = false;
+  bool stop_ = false;
+};
+
+} // namespace vbs
+
+#endif // ASYNCWRITER_H
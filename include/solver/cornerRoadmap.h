@@ -0,0 +1,107 @@
+#ifndef CORNERROADMAP_H
+#define CORNERROADMAP_H
+
+#include "environment/occupancyGrid.h"
+#include "parser/parser.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vbs {
+
+/*!
+ * @brief Visibility graph between the convex obstacle corners of a map, built
+ * once per map with visibilityBasedSolver::buildRoadmap(). Two corners are
+ * linked when each one sees the other at the visibility threshold of the
+ * roadmap, and a link weighs the distance between them. A query then only
+ * needs the visibility of its start and goal to enter and leave the graph,
+ * see visibilityBasedSolver::solveOnRoadmap().
+ *
+ * The links are stored in compressed rows, 12 bytes per corner and 8 per
+ * link. The roadmap is saved and loaded as is, together with a fingerprint of
+ * the occupancy it was built on.
+ */
+class CornerRoadmap {
+
+public:
+  using size_t = std::size_t;
+
+  /*!
+   * @brief Replace the roadmap.
+   * @param [in] occupancy Occupancy the roadmap is built on.
+   * @param [in] threshold Visibility threshold of the links.
+   * @param [in] nodes Corners.
+   * @param [in] links links[i] holds the corners linked to corner i, each link
+   * being in the lists of both of its corners.
+   */
+  void assign(const OccupancyGrid &occupancy, double threshold,
+              std::vector<point> nodes,
+              const std::vector<std::vector<std::uint32_t>> &links);
+
+  /*!
+   * @brief Save the roadmap to a binary file, in the byte order of the host.
+   * @param [in] filename Filename.
+   * @return false if the file could not be written.
+   */
+  bool save(const std::string &filename) const;
+
+  /*!
+   * @brief Load a roadmap saved with save().
+   * @param [in] filename Filename.
+   * @param [in] occupancy Occupancy of the map the roadmap is meant for.
+   * @return false if the file could not be read or was built on another map,
+   * the roadmap is then left empty.
+   */
+  bool load(const std::string &filename, const OccupancyGrid &occupancy);
+
+  // true if the roadmap was built on or loaded for the occupancy as it is
+  bool matches(const OccupancyGrid &occupancy) const {
+    return occupancy.nx() == nx_ && occupancy.ny() == ny_ &&
+           occupancy.revision() == revision_;
+  }
+
+  /*!
+   * @brief Shortest path from start to goal over the roadmap, with A*.
+   * @param [in] start Start cell.
+   * @param [in] goal Goal cell.
+   * @param [in] fromStart Corners the start sees.
+   * @param [in] toGoal Corners the goal sees.
+   * @param [out] path Start, the corners passed and goal, empty if the goal
+   * cannot be reached.
+   * @return Length of the path, infinite if the goal cannot be reached.
+   */
+  double search(const point &start, const point &goal,
+                const std::vector<std::uint32_t> &fromStart,
+                const std::vector<std::uint32_t> &toGoal,
+                std::vector<point> &path) const;
+
+  // Fingerprint of an occupancy, changes with its dimensions and any cell
+  static std::uint64_t fingerprint(const OccupancyGrid &occupancy);
+
+  inline size_t nodes() const { return nodes_.size(); }
+  // Number of links, each counted once
+  inline size_t links() const { return targets_.size() / 2; }
+  inline const point &node(const size_t i) const { return nodes_[i]; }
+  inline double threshold() const { return threshold_; }
+
+private:
+  void clear();
+
+  size_t nx_ = 0;
+  size_t ny_ = 0;
+  // Revision of the occupancy when the roadmap was built or loaded
+  size_t revision_ = 0;
+  std::uint64_t fingerprint_ = 0;
+  double threshold_ = 0;
+  std::vector<point> nodes_;
+  // Corners linked to corner i are targets_[offsets_[i]] to
+  // targets_[offsets_[i + 1] - 1]
+  std::vector<std::uint32_t> offsets_;
+  std::vector<std::uint32_t> targets_;
+};
+
+} // namespace vbs
+
+#endif // CORNERROADMAP_H
@@ -0,0 +1,108 @@
+#ifndef FRONTIERQUEUE_H
+#define FRONTIERQUEUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace vbs {
+
+/*!
+ * @brief FIFO of cells for the frontier visibility kernel. Cells are packed as
+ * x + y * nx in 32 bits, so grids hold at most 2^32 cells and resize()
+ * rejects larger ones. A bitset marks the
+ * cells queued since the last clear() and each cell is pushed at most once,
+ * so a buffer of one slot per cell never wraps. It doubles as the list of
+ * reached cells in queue order, which makes clear() proportional to them.
+ */
+class FrontierQueue {
+
+public:
+  using size_t = std::size_t;
+  using index = std::uint32_t;
+
+  // Largest number of cells of a grid
+  static constexpr size_t maxCells =
+      static_cast<size_t>(std::numeric_limits<index>::max()) + 1;
+
+  // Storage for a grid of nx by ny cells, kept if the dimensions match.
+  // Returns false and leaves an empty grid if it has more than maxCells.
+  bool resize(const size_t nx, const size_t ny) {
+    if (nx == nx_ && ny == ny_ && cells_) {
+      return true;
+    }
+    if (nx != 0 && ny > maxCells / nx) {
+      nx_ = 0;
+      ny_ = 0;
+      cells_.reset();
+      queued_.clear();
+      head_ = 0;
+      tail_ = 0;
+      return false;
+    }
+    nx_ = nx;
+    ny_ = ny;
+    cells_ = std::make_unique<index[]>(nx * ny);
+    queued_.assign((nx * ny + wordBits - 1) / wordBits, 0);
+    head_ = 0;
+    tail_ = 0;
+    return true;
+  }
+
+  // Forget the queued cells
+  void clear() {
+    for (size_t k = 0; k < tail_; ++k) {
+      queued_[cells_[k] / wordBits] = 0;
+    }
+    head_ = 0;
+    tail_ = 0;
+  }
+
+  // Queue cell (x, y) if it is in the grid and was not queued yet. Returns
+  // true if it was queued.
+  inline bool push(const size_t x, const size_t y) {
+    if (x >= nx_ || y >= ny_) {
+      return false;
+    }
+    const index cell = static_cast<index>(x + y * nx_);
+    word &w = queued_[cell / wordBits];
+    const word bit = word(1) << (cell % wordBits);
+    if (w & bit) {
+      return false;
+    }
+    w |= bit;
+    cells_[tail_++] = cell;
+    return true;
+  }
+
+  inline bool empty() const { return head_ == tail_; }
+  inline index pop() { return cells_[head_++]; }
+
+  // true if cell (x, y), in the grid, was queued since the last clear()
+  inline bool isQueued(const size_t x, const size_t y) const {
+    const size_t cell = x + y * nx_;
+    return (queued_[cell / wordBits] >> (cell % wordBits)) & 1;
+  }
+
+  // Cells queued since the last clear(), in queue order
+  inline const index *begin() const { return cells_.get(); }
+  inline const index *end() const { return cells_.get() + tail_; }
+  inline size_t size() const { return tail_; }
+
+private:
+  using word = std::uint64_t;
+  static constexpr size_t wordBits = 64;
+
+  size_t nx_ = 0;
+  size_t ny_ = 0;
+  std::unique_ptr<index[]> cells_;
+  std::vector<word> queued_;
+  size_t head_ = 0;
+  size_t tail_ = 0;
+};
+
+} // namespace vbs
+
+#endif // FRONTIERQUEUE_H
@@ -0,0 +1,280 @@
+#ifndef LAZYVISIBILITY_H
+#define LAZYVISIBILITY_H
+
+#include "environment/field.h"
+#include "environment/occupancyGrid.h"
+#include "parser/parser.h"
+#include "solver/quadrantSweep.h"
+#include "solver/valueTraits.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vbs {
+
+/*!
+ * @brief Visibility of single cells from a light source, evaluated on demand.
+ *
+ * In the quadrant sweep a cell at local offset (i, j) from the source reads
+ * (i, j - 1) and (i - 1, j - 1) below the diagonal (i < j), (i - 1, j) and
+ * (i - 1, j - 1) above it (i > j), and (i, j - 1) on it. A cell below the
+ * diagonal thus depends on columns i - (j - j') to i of row j' only, a cone
+ * along its characteristic that the cells next to the diagonal close. Above
+ * the diagonal the same holds with rows and columns swapped. Only that cone
+ * is evaluated, with the formulas of the sweep, so a value matches the sweep
+ * up to rounding. Cell by cell is several times slower than the sweep, so a
+ * quadrant is swept whole instead once a cone would cover a good part of it.
+ *
+ * Evaluated cells are kept for the following queries from the same source.
+ * They are stamped with an epoch, so moving to another source or to a new
+ * revision of the occupancy forgets them at no cost.
+ */
+template <typename T> class LazyVisibility {
+public:
+  using traits = valueTraits<T>;
+  using value = typename traits::compute;
+
+  // Storage for a grid of nx by ny cells, kept if the dimensions match
+  void resize(const size_t nx, const size_t ny) {
+    if (nx == values_.nx() && ny == values_.ny()) {
+      return;
+    }
+    values_.resize(nx, ny, traits::fromDouble(0.0));
+    stamps_.assign(nx * ny, 0);
+    epoch_ = 0;
+  }
+
+  /*!
+   * @brief Visibility of a cell from a light source, as the sweep of that
+   * source gives it.
+   * @param [in] occupancy Occupancy complement, of the grid dimensions.
+   * @param [in] source Light source, must be in the grid.
+   * @param [in] lightStrength Value at the light source.
+   * @param [in] cell Cell, must be in the grid.
+   */
+  T at(const OccupancyGrid &occupancy, const point &source,
+       const double lightStrength, const point &cell) {
+    if (epoch_ == 0 || source != source_ || lightStrength != lightStrength_ ||
+        occupancy.revision() != revision_) {
+      forget();
+      source_ = source;
+      lightStrength_ = lightStrength;
+      revision_ = occupancy.revision();
+    }
+    const size_t x0 = source.first;
+    const size_t y0 = source.second;
+    const size_t x = cell.first;
+    const size_t y = cell.second;
+    // Column 0 and row 0 of the grid are in no quadrant unless the source is
+    // on them, see quadrantsAround()
+    if ((x == 0 && x0 > 0) || (y == 0 && y0 > 0)) {
+      return traits::fromDouble(0.0);
+    }
+    dx_ = x >= x0 ? 1 : -1;
+    const std::ptrdiff_t dy = y >= y0 ? 1 : -1;
+    // In the Q1..Q4 order of quadrantsAround()
+    quadrant_ = dy > 0 ? (dx_ > 0 ? 0 : 1) : (dx_ > 0 ? 3 : 2);
+    const size_t I = x >= x0 ? x - x0 : x0 - x;
+    const size_t J = y >= y0 ? y - y0 : y0 - y;
+    const size_t nx = values_.nx();
+    origin_ = &values_(x0, y0);
+    stampOrigin_ = stamps_.data() + x0 + y0 * nx;
+    occOrigin_ = occupancy.row(y0);
+    rowStep_ = dy * static_cast<std::ptrdiff_t>(nx);
+    occRowStep_ = dy * static_cast<std::ptrdiff_t>(occupancy.wordsPerRow());
+
+    if (isKnown(I, J)) {
+      return origin_[offset(I, J)];
+    }
+    // The cone covers about half of its bounding box
+    const Quadrant q = quadrantsAround(source, nx, values_.ny())[quadrant_];
+    if ((I + 1) * (J + 1) / 2 * sweepShare > q.extentX * q.extentY) {
+      Window window{x0, x0 + 1, y0, y0 + 1};
+      if (q.dx > 0) {
+        window.xEnd = x0 + q.extentX;
+      } else {
+        window.xBegin = x0 + 1 - q.extentX;
+      }
+      if (q.dy > 0) {
+        window.yEnd = y0 + q.extentY;
+      } else {
+        window.yBegin = y0 + 1 - q.extentY;
+      }
+      sweepAxes(values_, occupancy, source, lightStrength, window);
+      sweepQuadrant(values_, occupancy, source, q,
+                    [](size_t, size_t, size_t) {});
+      sweptEpoch_[quadrant_] = epoch_;
+      return origin_[offset(I, J)];
+    }
+    axes(I, J);
+    if (I > 0 && J > 0) {
+      if (I < J) {
+        steep(I, J);
+      } else if (I > J) {
+        shallow(I, J);
+      } else {
+        // The diagonal reads the cell before it along y only
+        if (I > 1) {
+          shallow(I, I - 1);
+        }
+        evaluate(I, J);
+      }
+    }
+    return origin_[offset(I, J)];
+  }
+
+private:
+  // Forget the evaluated cells
+  void forget() {
+    if (++epoch_ == 0) {
+      std::fill(stamps_.begin(), stamps_.end(), 0);
+      sweptEpoch_.fill(0);
+      epoch_ = 1;
+    }
+  }
+
+  inline std::ptrdiff_t offset(const size_t i, const size_t j) const {
+    return static_cast<std::ptrdiff_t>(j) * rowStep_ +
+           dx_ * static_cast<std::ptrdiff_t>(i);
+  }
+
+  inline value get(const size_t i, const size_t j) const {
+    return traits::toCompute(origin_[offset(i, j)]);
+  }
+
+  // Local row 0 up to column I and local column 0 up to row J, as
+  // sweepAxes() transports them
+  void axes(const size_t I, const size_t J) {
+    if (stampOrigin_[0] != epoch_) {
+      origin_[0] = traits::fromDouble(
+          lightStrength_ * OccupancyGrid::isFree(occOrigin_, source_.first));
+      stampOrigin_[0] = epoch_;
+    }
+    for (size_t i = 1; i <= I; ++i) {
+      const std::ptrdiff_t o = offset(i, 0);
+      if (stampOrigin_[o] != epoch_) {
+        origin_[o] = traits::fromCompute(
+            get(i - 1, 0) *
+            static_cast<value>(OccupancyGrid::isFree(
+                occOrigin_,
+                source_.first + dx_ * static_cast<std::ptrdiff_t>(i))));
+        stampOrigin_[o] = epoch_;
+      }
+    }
+    for (size_t j = 1; j <= J; ++j) {
+      const std::ptrdiff_t o = offset(0, j);
+      if (stampOrigin_[o] != epoch_) {
+        origin_[o] = traits::fromCompute(
+            get(0, j - 1) *
+            static_cast<value>(OccupancyGrid::isFree(
+                occOrigin_ + static_cast<std::ptrdiff_t>(j) * occRowStep_,
+                source_.first)));
+        stampOrigin_[o] = epoch_;
+      }
+    }
+  }
+
+  // Cell (i, j) off the axes, from the cells it reads
+  inline void evaluate(const size_t i, const size_t j) {
+    const std::ptrdiff_t o = offset(i, j);
+    if (stampOrigin_[o] == epoch_) {
+      return;
+    }
+    value v;
+    if (i < j) {
+      const value c = static_cast<value>(i) / static_cast<value>(j);
+      const value p = get(i, j - 1);
+      v = p - c * (p - get(i - 1, j - 1));
+    } else if (i == j) {
+      v = get(i, j - 1);
+    } else {
+      const value c = static_cast<value>(j) / static_cast<value>(i);
+      const value left = get(i - 1, j);
+      v = left - c * (left - get(i - 1, j - 1));
+    }
+    const value occ = OccupancyGrid::isFree(
+        occOrigin_ + static_cast<std::ptrdiff_t>(j) * occRowStep_,
+        source_.first + dx_ * static_cast<std::ptrdiff_t>(i));
+    origin_[o] = traits::fromCompute(v * occ);
+    stampOrigin_[o] = epoch_;
+  }
+
+  inline bool isKnown(const size_t i, const size_t j) const {
+    return sweptEpoch_[quadrant_] == epoch_ ||
+           stampOrigin_[offset(i, j)] == epoch_;
+  }
+
+  // Cone of (I, J) below the diagonal, row by row. Rows reach one column
+  // past the diagonal, which the diagonal of the next row reads. A row of
+  // the cone only reads the row before it, so the rows up to the last one
+  // already known are skipped.
+  void steep(const size_t I, const size_t J) {
+    auto first = [&](const size_t j) { return I + j > J ? I + j - J : 1; };
+    auto last = [&](const size_t j) { return std::min(I, j + 1); };
+    size_t known = J;
+    for (; known > 0; --known) {
+      size_t i = first(known);
+      while (i <= last(known) && isKnown(i, known)) {
+        ++i;
+      }
+      if (i > last(known)) {
+        break;
+      }
+    }
+    for (size_t j = known + 1; j <= J; ++j) {
+      for (size_t i = first(j); i <= last(j); ++i) {
+        evaluate(i, j);
+      }
+    }
+  }
+
+  // Cone of (I, J) above the diagonal, column by column
+  void shallow(const size_t I, const size_t J) {
+    auto first = [&](const size_t i) { return J + i > I ? J + i - I : 1; };
+    auto last = [&](const size_t i) { return std::min(J, i); };
+    size_t known = I;
+    for (; known > 0; --known) {
+      size_t j = first(known);
+      while (j <= last(known) && isKnown(known, j)) {
+        ++j;
+      }
+      if (j > last(known)) {
+        break;
+      }
+    }
+    for (size_t i = known + 1; i <= I; ++i) {
+      for (size_t j = first(i); j <= last(i); ++j) {
+        evaluate(i, j);
+      }
+    }
+  }
+
+  // A quadrant is swept whole when a cone covers more than 1 / sweepShare
+  // of it
+  static constexpr size_t sweepShare = 8;
+
+  // Evaluated values, valid where the stamp is the epoch and in the
+  // quadrants whose swept epoch is
+  Field<T> values_;
+  std::vector<std::uint32_t> stamps_;
+  std::array<std::uint32_t, 4> sweptEpoch_{};
+  std::uint32_t epoch_ = 0;
+  point source_{-1, -1};
+  double lightStrength_ = 0;
+  size_t revision_ = 0;
+
+  // Frame of the quadrant of the last query
+  size_t quadrant_ = 0;
+  T *origin_ = nullptr;
+  std::uint32_t *stampOrigin_ = nullptr;
+  const OccupancyGrid::word *occOrigin_ = nullptr;
+  std::ptrdiff_t dx_ = 1;
+  std::ptrdiff_t rowStep_ = 0;
+  std::ptrdiff_t occRowStep_ = 0;
+};
+
+} // namespace vbs
+#endif // LAZYVISIBILITY_H
@@ -0,0 +1,172 @@
+#ifndef PARALLELSWEEP_H
+#define PARALLELSWEEP_H
+
+#include "solver/quadrantSweep.h"
+#include "solver/threadPool.h"
+
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace vbs {
+
+// A run of local columns [iBegin, iEnd) of one quadrant. The unit of work
+// of the parallel sweep.
+struct SweepBlock {
+  size_t quadrant;
+  size_t iBegin, iEnd;
+};
+
+/*!
+ * @brief Split the quadrants into column blocks for a given number of
+ * threads. Each quadrant gets a share of blocks proportional to its area,
+ * at least one and no block narrower than minBlockWidth. Blocks of the same
+ * quadrant are consecutive and ordered away from the source.
+ * @param [in] quadrants Quadrants around the light source.
+ * @param [in] threads Number of threads.
+ * @param [out] blocks Column blocks, replacing its content.
+ * @param [in] minBlockWidth Narrowest block worth synchronizing for.
+ */
+inline void partitionQuadrants(const std::array<Quadrant, 4> &quadrants,
+                               const size_t threads,
+                               std::vector<SweepBlock> &blocks,
+                               const size_t minBlockWidth = 256) {
+  double totalArea = 0;
+  for (const auto &q : quadrants) {
+    totalArea += static_cast<double>(q.extentX) * q.extentY;
+  }
+  blocks.clear();
+  for (size_t k = 0; k < quadrants.size(); ++k) {
+    const Quadrant &q = quadrants[k];
+    if (q.extentX == 0 || q.extentY == 0) {
+      continue;
+    }
+    const double share = threads * (q.extentX * (double)q.extentY) / totalArea;
+    const size_t maxBlocks = std::max<size_t>(1, q.extentX / minBlockWidth);
+    const size_t nbBlocks =
+        std::clamp<size_t>(std::lround(share), 1, maxBlocks);
+    const size_t width = (q.extentX + nbBlocks - 1) / nbBlocks;
+    for (size_t i = 0; i < q.extentX; i += width) {
+      blocks.push_back({k, i, std::min(i + width, q.extentX)});
+    }
+  }
+}
+
+/*!
+ * @brief Scratch of sweepQuadrantsParallel(): the column blocks, the strips
+ * every block has completed and the tiles of every block. A workspace kept
+ * across sweeps reuses its storage, so that a sweep allocates nothing once
+ * the workspace has seen its largest partition.
+ */
+template <typename T, typename Pack = simd::nativePack<T>>
+class SweepWorkspace {
+public:
+  using Tile = typename QuadrantSweep<T, Pack>::Tile;
+
+  // Split the quadrants into the blocks of the next sweep
+  void partition(const std::array<Quadrant, 4> &quadrants,
+                 const size_t threads) {
+    partitionQuadrants(quadrants, threads, blocks_);
+  }
+
+  inline const std::vector<SweepBlock> &blocks() const { return blocks_; }
+
+  // Size the buffers for the blocks and zero the progress of every block
+  void prepare() {
+    const size_t n = blocks_.size();
+    if (progressSize_ < n) {
+      progress_ = std::make_unique<std::atomic<size_t>[]>(n);
+      progressSize_ = n;
+    }
+    for (size_t k = 0; k < n; ++k) {
+      progress_[k].store(0, std::memory_order_relaxed);
+    }
+    // The tiles of a block start on their own cache line, as blocks write
+    // them concurrently
+    tileOffsets_.resize(n + 1);
+    tileOffsets_[0] = 0;
+    for (size_t k = 0; k < n; ++k) {
+      const size_t tiles = QuadrantSweep<T, Pack>::tilesIn(blocks_[k].iBegin,
+                                                           blocks_[k].iEnd);
+      tileOffsets_[k + 1] = tileOffsets_[k] + (tiles + 63) / 64 * 64;
+    }
+    if (tiles_.size() < tileOffsets_[n]) {
+      tiles_.resize(tileOffsets_[n]);
+    }
+  }
+
+  // Strips block k has completed
+  inline std::atomic<size_t> &progress(const size_t k) {
+    return progress_[k];
+  }
+
+  // Tiles of block k
+  inline Tile *tiles(const size_t k) { return &tiles_[tileOffsets_[k]]; }
+
+private:
+  std::vector<SweepBlock> blocks_;
+  std::unique_ptr<std::atomic<size_t>[]> progress_;
+  size_t progressSize_ = 0;
+  std::vector<size_t> tileOffsets_;
+  std::vector<Tile> tiles_;
+};
+
+/*!
+ * @brief Sweep all quadrants on a thread pool. Quadrants are independent
+ * once the axes are set, so they run on separate threads. Inside a quadrant
+ * every column block sweeps its strips in order and starts a strip only
+ * once the block before it has finished that strip, so the blocks of a
+ * quadrant advance as a pipeline one strip apart. The axes must have been
+ * set by sweepAxes().
+ * @param [in] pool Thread pool.
+ * @param [in, out] workspace Scratch of the sweep, holding the column blocks
+ * from partitionQuadrants().
+ * @param [in, out] visibility Visibility field written by the sweep.
+ * @param [in] occupancy Occupancy complement.
+ * @param [in] ls Light source.
+ * @param [in] quadrants Quadrants around the light source.
+ * @param [in] onRow Called as onRow(block, y, xBegin, xEnd) once the part of
+ * row y owned by the block is complete, once per run of cells that are not
+ * in a dark tile. Calls for different blocks run concurrently and never
+ * cover the same cell.
+ */
+template <typename T, typename Pack = simd::nativePack<T>, typename RowOp>
+void sweepQuadrantsParallel(ThreadPool &pool,
+                            SweepWorkspace<T, Pack> &workspace,
+                            Field<T> &visibility,
+                            const OccupancyGrid &occupancy,
+                            const point &ls,
+                            const std::array<Quadrant, 4> &quadrants,
+                            RowOp &&onRow) {
+  workspace.prepare();
+  const std::vector<SweepBlock> &blocks = workspace.blocks();
+
+  pool.run(blocks.size(), [&](const size_t k) {
+    const SweepBlock &block = blocks[k];
+    using Sweep = QuadrantSweep<T, Pack>;
+    const Sweep sweep(visibility, occupancy, ls, quadrants[block.quadrant]);
+    typename Sweep::Tile *tiles = workspace.tiles(k);
+    auto blockRow = [&](size_t y, size_t xBegin, size_t xEnd) {
+      onRow(k, y, xBegin, xEnd);
+    };
+
+    sweep.forOwnedRows(sweep.npos, block.iBegin, block.iEnd, blockRow);
+    for (size_t s = 0; s < sweep.strips(); ++s) {
+      if (block.iBegin > 0) {
+        while (workspace.progress(k - 1).load(std::memory_order_acquire) <=
+               s) {
+          std::this_thread::yield();
+        }
+      }
+      sweep.sweepStrip(s, block.iBegin, block.iEnd, tiles);
+      workspace.progress(k).store(s + 1, std::memory_order_release);
+      sweep.forOwnedRows(s, block.iBegin, block.iEnd, blockRow, tiles);
+    }
+  });
+}
+
+} // namespace vbs
+
+#endif // PARALLELSWEEP_H
@@ -0,0 +1,164 @@
+#ifndef PIVOTINDEX_H
+#define PIVOTINDEX_H
+
+#include "solver/threadPool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace vbs {
+
+// Candidate pivot: a cell and its heuristic value h
+struct Node {
+  size_t x, y;
+  double h;
+};
+
+// Order in which pivots are picked: lowest h first, ties broken by row-major
+// position so the pick does not depend on how the sweep was scheduled.
+inline bool precedes(const Node &a, const Node &b) {
+  if (a.h != b.h) {
+    return a.h < b.h;
+  }
+  return a.y != b.y ? a.y < b.y : a.x < b.x;
+}
+
+/*!
+ * @brief Best pivot candidate of every square tile of the grid, with a
+ * tournament tree over the tiles whose root is the best candidate overall.
+ * Between two pivots only the tiles whose cells changed are touched: a new
+ * candidate is offered to its tile, and a tile whose best cell got worse is
+ * invalidated and rescanned. update() then replays the touched leaves up the
+ * tree, so an iteration costs the touched tiles times log of the tile count.
+ */
+class PivotIndex {
+public:
+  static constexpr size_t tileSize = 32;
+
+  // Forget every candidate of a grid of nx by ny cells
+  void reset(const size_t nx, const size_t ny) {
+    tilesX_ = (nx + tileSize - 1) / tileSize;
+    tiles_ = tilesX_ * ((ny + tileSize - 1) / tileSize);
+    leaves_ = 1;
+    while (leaves_ < tiles_) {
+      leaves_ *= 2;
+    }
+    tree_.assign(2 * leaves_, none());
+    state_.assign(leaves_, clean);
+    // Every tile fits, so touching tiles never allocates
+    touched_.clear();
+    touched_.reserve(tiles_);
+    invalid_.clear();
+    invalid_.reserve(tiles_);
+  }
+
+  // Candidate that loses against every other one
+  static Node none() {
+    return Node{0, 0, std::numeric_limits<double>::infinity()};
+  }
+
+  inline size_t tileOf(const size_t x, const size_t y) const {
+    return x / tileSize + (y / tileSize) * tilesX_;
+  }
+
+  // Best candidate of a tile as of the last update()
+  inline const Node &tileBest(const size_t tile) const {
+    return tree_[leaves_ + tile];
+  }
+
+  // Best candidate overall as of the last update()
+  inline const Node &best() const { return tree_[1]; }
+
+  // Offer a new candidate to a tile
+  void offer(const size_t tile, const Node &candidate) {
+    Node &leaf = tree_[leaves_ + tile];
+    if (precedes(candidate, leaf)) {
+      leaf = candidate;
+      touch(tile, touchedState);
+    }
+  }
+
+  // The best candidate of a tile got worse, rescan it on update()
+  void invalidate(const size_t tile) { touch(tile, invalidState); }
+
+  /*!
+   * @brief Rescan the invalidated tiles and replay every touched tile up the
+   * tree.
+   * @param [in] pool Threads rescanning the tiles.
+   * @param [in] nx Number of columns.
+   * @param [in] ny Number of rows.
+   * @param [in] heuristics heuristics(y, x0, x1, h) writes the value h of
+   * the cells [x0, x1) of row y to h[x - x0], infinite for cells that are not
+   * candidates. x1 - x0 is at most tileSize. Called concurrently for
+   * different tiles.
+   * @return Number of rescanned tiles.
+   */
+  template <typename Heuristics>
+  size_t update(ThreadPool &pool, const size_t nx, const size_t ny,
+                Heuristics &&heuristics) {
+    pool.run(invalid_.size(), [&](const size_t k) {
+      const size_t tile = invalid_[k];
+      const size_t x0 = (tile % tilesX_) * tileSize;
+      const size_t x1 = std::min(x0 + tileSize, nx);
+      const size_t y0 = (tile / tilesX_) * tileSize;
+      alignas(64) double h[tileSize];
+      Node best = none();
+      for (size_t y = y0; y < std::min(y0 + tileSize, ny); ++y) {
+        heuristics(y, x0, x1, h);
+        for (size_t x = x0; x < x1; ++x) {
+          const Node candidate{x, y, h[x - x0]};
+          if (precedes(candidate, best)) {
+            best = candidate;
+          }
+        }
+      }
+      tree_[leaves_ + tile] = best;
+    });
+
+    for (const size_t tile : touched_) {
+      state_[tile] = clean;
+      for (size_t i = (leaves_ + tile) / 2; i > 0; i /= 2) {
+        const Node &left = tree_[2 * i];
+        const Node &right = tree_[2 * i + 1];
+        tree_[i] = precedes(right, left) ? right : left;
+      }
+    }
+    const size_t rescanned = invalid_.size();
+    touched_.clear();
+    invalid_.clear();
+    return rescanned;
+  }
+
+private:
+  static constexpr std::uint8_t clean = 0;
+  static constexpr std::uint8_t touchedState = 1;
+  static constexpr std::uint8_t invalidState = 2;
+
+  void touch(const size_t tile, const std::uint8_t state) {
+    if (state_[tile] == clean) {
+      touched_.push_back(tile);
+    }
+    if (state == invalidState && state_[tile] != invalidState) {
+      invalid_.push_back(tile);
+    }
+    state_[tile] = std::max(state_[tile], state);
+  }
+
+  size_t tilesX_ = 0;
+  size_t tiles_ = 0;
+  size_t leaves_ = 1;
+  // Tournament tree, node i has children 2i and 2i + 1 and tile t is leaf
+  // leaves_ + t. Leaves past the last tile stay none().
+  std::vector<Node> tree_;
+  // Touched and invalidated tiles since the last update()
+  std::vector<std::uint8_t> state_;
+  std::vector<size_t> touched_;
+  std::vector<size_t> invalid_;
+};
+
+} // namespace vbs
+
+#endif // PIVOTINDEX_H
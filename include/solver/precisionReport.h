@@ -0,0 +1,26 @@
+#ifndef PRECISIONREPORT_H
+#define PRECISIONREPORT_H
+
+#include "parser/parser.h"
+
+#include <string>
+
+namespace vbs {
+
+/*!
+ * @brief Compare the float and fixed16 visibility against double on every
+ * PNG image of a directory. For each image the stand-alone visibility of one
+ * source is computed in the three precisions, and the report gives the sweep
+ * time, the largest and mean absolute error to double, and the share of free
+ * cells whose side of the visibility threshold changes. A summary over all
+ * images closes the report.
+ * @param [in] config Parsed configuration. Mode, image path, saving and
+ * verbosity are overridden, the start point is used as the source and moved
+ * to the next free cell if it is occupied or out of the image.
+ * @param [in] directory Directory holding the images.
+ */
+void reportPrecision(const Config &config, const std::string &directory);
+
+} // namespace vbs
+
+#endif // PRECISIONREPORT_H
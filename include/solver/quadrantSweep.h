@@ -0,0 +1,851 @@
+#ifndef QUADRANTSWEEP_H
+#define QUADRANTSWEEP_H
+
+#include "environment/field.h"
+#include "environment/occupancyGrid.h"
+#include "parser/parser.h"
+#include "solver/simd.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace vbs {
+
+// One of the four quadrants around a light source. dx and dy are the steps
+// (+1 or -1) taken when walking away from the source, extentX and extentY are
+// the number of columns and rows covered, source row and column included.
+struct Quadrant {
+  int dx, dy;
+  size_t extentX, extentY;
+};
+
+/*!
+ * @brief The four quadrants around a light source, in the Q1..Q4 order used
+ * by the solver. Q2 and Q3 stop short of column 0 and Q3 and Q4 stop short of
+ * row 0, as the original column loops did.
+ * @param [in] ls Light source.
+ * @param [in] nx Number of columns.
+ * @param [in] ny Number of rows.
+ */
+inline std::array<Quadrant, 4> quadrantsAround(const point &ls, size_t nx,
+                                               size_t ny) {
+  const size_t x = ls.first;
+  const size_t y = ls.second;
+  return {{{1, 1, nx - x, ny - y},
+           {-1, 1, x, ny - y},
+           {-1, -1, x, y},
+           {1, -1, nx - x, y}}};
+}
+
+// Columns [xBegin, xEnd) of rows [yBegin, yEnd) of the grid
+struct Window {
+  size_t xBegin, xEnd;
+  size_t yBegin, yEnd;
+};
+
+/*!
+ * @brief The cells at most radius columns and rows away from a light source.
+ * @param [in] ls Light source.
+ * @param [in] nx Number of columns.
+ * @param [in] ny Number of rows.
+ * @param [in] radius Half width of the window.
+ */
+inline Window windowAround(const point &ls, const size_t nx, const size_t ny,
+                           const size_t radius) {
+  const size_t x = ls.first;
+  const size_t y = ls.second;
+  return {x - std::min(x, radius), x + std::min(nx - 1 - x, radius) + 1,
+          y - std::min(y, radius), y + std::min(ny - 1 - y, radius) + 1};
+}
+
+/*!
+ * @brief The four quadrants around a light source cut to windowAround(), so
+ * that a sweep with a limited range costs the window and not the grid.
+ * @param [in] ls Light source.
+ * @param [in] nx Number of columns.
+ * @param [in] ny Number of rows.
+ * @param [in] radius Half width of the window.
+ */
+inline std::array<Quadrant, 4> quadrantsAround(const point &ls, size_t nx,
+                                               size_t ny, size_t radius) {
+  auto quadrants = quadrantsAround(ls, nx, ny);
+  for (auto &q : quadrants) {
+    if (q.extentX > radius) {
+      q.extentX = radius + 1;
+    }
+    if (q.extentY > radius) {
+      q.extentY = radius + 1;
+    }
+  }
+  return quadrants;
+}
+
+/*!
+ * @brief Directions within half an aperture of a heading, e.g. the field of
+ * view of a directional sensor. Angles are in radians from the x axis
+ * towards the y axis, an aperture of 2 pi or more is every direction.
+ */
+class Sector {
+public:
+  Sector(const double heading, const double aperture)
+      : heading_(heading), aperture_(std::min(aperture, 2 * pi)),
+        ux_(std::cos(heading)), uy_(std::sin(heading)),
+        cosHalf_(std::cos(aperture_ / 2)),
+        rightX_(std::cos(heading - aperture_ / 2)),
+        rightY_(std::sin(heading - aperture_ / 2)),
+        leftX_(std::cos(heading + aperture_ / 2)),
+        leftY_(std::sin(heading + aperture_ / 2)) {}
+
+  inline bool isFull() const { return aperture_ >= 2 * pi; }
+
+  // true if the cells of the sector on any row are one run. Otherwise the
+  // cells outside of it are, see opposite().
+  inline bool isConvex() const { return aperture_ <= pi || isFull(); }
+
+  // true if the direction (dx, dy) is in the sector, (0, 0) always is
+  inline bool contains(const double dx, const double dy) const {
+    if (isFull() || (dx == 0 && dy == 0)) {
+      return true;
+    }
+    // Compare squares against cos(aperture / 2) * |d| so that no root is
+    // taken, with some slack for the cells on the edges
+    const double dot = dx * ux_ + dy * uy_;
+    const double bound = cosHalf_ * cosHalf_ * (dx * dx + dy * dy);
+    if (cosHalf_ >= 0) {
+      return dot >= 0 && dot * dot >= bound * (1 - slack);
+    }
+    return dot >= 0 || dot * dot <= bound * (1 + slack);
+  }
+
+  /*!
+   * @brief Narrow [lo, hi] to the column offsets of the sector on the row dy
+   * away from the apex, for a convex sector. The bounds are those of the
+   * edges, cells on them can fall either side of contains().
+   * @param [in] dy Row offset from the apex.
+   * @param [in, out] lo Lowest column offset.
+   * @param [in, out] hi Highest column offset, lower than lo if none is left.
+   */
+  void narrow(const double dy, double &lo, double &hi) const {
+    if (isFull()) {
+      return;
+    }
+    // k * dx <= m
+    auto bound = [&](const double k, const double m) {
+      if (k > 0) {
+        hi = std::min(hi, m / k);
+      } else if (k < 0) {
+        lo = std::max(lo, m / k);
+      } else if (m < 0) {
+        hi = lo - 1;
+      }
+    };
+    // Left of the right edge, right of the left edge and ahead of the apex
+    bound(rightY_, rightX_ * dy);
+    bound(-leftY_, -leftX_ * dy);
+    bound(-ux_, uy_ * dy);
+  }
+
+  /*!
+   * @brief Where the ray opposite to the heading crosses the row dy away from
+   * the apex. When the sector is wider than a half turn and its complement
+   * meets the row in a bounded run, the run is around this crossing.
+   * @param [in] dy Row offset from the apex.
+   * @param [out] dx Column offset of the crossing.
+   * @return false if the ray does not cross the row.
+   */
+  bool opposite(const double dy, double &dx) const {
+    if (-uy_ * dy <= 0) {
+      return false;
+    }
+    dx = ux_ * dy / uy_;
+    return true;
+  }
+
+  /*!
+   * @brief Angles of the sector in a quadrant, measured from the local x
+   * axis of the quadrant (towards local y), i.e. between 0 and pi / 2.
+   * @param [in] q Quadrant.
+   * @param [out] lo Smallest angle.
+   * @param [out] hi Largest angle.
+   * @return false if the sector misses the quadrant.
+   */
+  bool anglesIn(const Quadrant &q, double &lo, double &hi) const {
+    lo = 0;
+    hi = pi / 2;
+    if (isFull()) {
+      return true;
+    }
+    // Direction of the local x axis of the quadrant, the quadrant covers the
+    // quarter turn after it when dx * dy > 0 and before it otherwise
+    const double start = q.dx > 0 ? (q.dy > 0 ? 0 : 1.5 * pi)
+                                   : (q.dy > 0 ? 0.5 * pi : pi);
+    // Start of the sector relative to the quadrant, in [0, 2 pi)
+    double u = std::fmod(heading_ - aperture_ / 2 - start, 2 * pi);
+    if (u < 0) {
+      u += 2 * pi;
+    }
+    const bool first = u <= pi / 2;
+    const bool wraps = u + aperture_ >= 2 * pi;
+    if (!first && !wraps) {
+      return false;
+    }
+    const double uLo = wraps ? 0 : u;
+    const double uHi =
+        std::min(pi / 2, std::max(first ? u + aperture_ : 0.0,
+                                  wraps ? u + aperture_ - 2 * pi : 0.0));
+    if (q.dx * q.dy > 0) {
+      lo = uLo;
+      hi = uHi;
+    } else {
+      lo = pi / 2 - uHi;
+      hi = pi / 2 - uLo;
+    }
+    return true;
+  }
+
+private:
+  static constexpr double pi = 3.14159265358979323846;
+  static constexpr double slack = 1e-12;
+  double heading_;
+  double aperture_;
+  // Unit vector of the heading
+  double ux_, uy_;
+  double cosHalf_;
+  // Unit vectors of the edges, clockwise and counterclockwise of the heading
+  double rightX_, rightY_;
+  double leftX_, leftY_;
+};
+
+/*!
+ * @brief The four quadrants around a light source cut to windowAround() and
+ * to the bounding box of a sector within them, so that a sweep covers the
+ * sector and what it depends on only. A cell depends on cells of lower or
+ * equal local row and column only, so the sweep of a cut quadrant gives the
+ * same values as that of the whole one. Quadrants the sector misses are
+ * empty.
+ * @param [in] ls Light source.
+ * @param [in] nx Number of columns.
+ * @param [in] ny Number of rows.
+ * @param [in] radius Half width of the window.
+ * @param [in] sector Sector of the light.
+ * @param [in] stripRows Rows of a strip of the sweep. Rows are cut at the
+ * end of a strip so that the strips, whose last one is swept differently
+ * when it is partial, are the ones of the whole quadrant.
+ */
+inline std::array<Quadrant, 4>
+quadrantsAround(const point &ls, size_t nx, size_t ny, size_t radius,
+                const Sector &sector, const size_t stripRows) {
+  auto quadrants = quadrantsAround(ls, nx, ny, radius);
+  for (auto &q : quadrants) {
+    double lo, hi;
+    if (q.extentX == 0 || q.extentY == 0 || !sector.anglesIn(q, lo, hi)) {
+      q.extentX = 0;
+      q.extentY = 0;
+      continue;
+    }
+    // Furthest local column and row of the sector, whose edges are rays
+    const double maxI = static_cast<double>(q.extentX - 1);
+    const double maxJ = static_cast<double>(q.extentY - 1);
+    if (maxJ * std::cos(lo) < maxI * std::sin(lo)) {
+      q.extentX = static_cast<size_t>(
+                      std::ceil(maxJ * std::cos(lo) / std::sin(lo))) +
+                  1;
+    }
+    if (maxI * std::sin(hi) < maxJ * std::cos(hi)) {
+      const size_t lastJ =
+          static_cast<size_t>(std::ceil(maxI * std::sin(hi) / std::cos(hi)));
+      const size_t strips = lastJ > 0 ? (lastJ - 1) / stripRows + 1 : 0;
+      q.extentY = std::min(q.extentY, 1 + strips * stripRows);
+    }
+  }
+  return quadrants;
+}
+
+/*!
+ * @brief The smallest window holding a light source and its quadrants.
+ * @param [in] ls Light source.
+ * @param [in] quadrants Quadrants around the source.
+ */
+inline Window windowOf(const point &ls,
+                       const std::array<Quadrant, 4> &quadrants) {
+  const size_t x = ls.first;
+  const size_t y = ls.second;
+  Window window{x, x + 1, y, y + 1};
+  for (const auto &q : quadrants) {
+    if (q.extentX == 0 || q.extentY == 0) {
+      continue;
+    }
+    if (q.dx > 0) {
+      window.xEnd = std::max(window.xEnd, x + q.extentX);
+    } else {
+      window.xBegin = std::min(window.xBegin, x + 1 - q.extentX);
+    }
+    if (q.dy > 0) {
+      window.yEnd = std::max(window.yEnd, y + q.extentY);
+    } else {
+      window.yBegin = std::min(window.yBegin, y + 1 - q.extentY);
+    }
+  }
+  return window;
+}
+
+/*!
+ * @brief Transport visibility along the four axis rays leaving the light
+ * source, i.e. row 0 and column 0 of every quadrant. The quadrant sweeps
+ * read these but never write them, so quadrants can run concurrently. Row 0
+ * and column 0 of the grid, which no quadrant covers unless the source is on
+ * them, are cleared so that the axes and the sweeps write every cell of the
+ * window.
+ * @param [in, out] visibility Visibility field written by the sweep.
+ * @param [in] occupancy Occupancy complement.
+ * @param [in] ls Light source.
+ * @param [in] lightStrength Value at the light source.
+ * @param [in] window Window swept around the source, it must contain it.
+ */
+template <typename T>
+void sweepAxes(Field<T> &visibility, const OccupancyGrid &occupancy,
+               const point &ls, const double lightStrength,
+               const Window &window) {
+  using traits = valueTraits<T>;
+  using value = typename traits::compute;
+  const size_t x0 = ls.first;
+  const size_t y0 = ls.second;
+  // Product of the value behind and the occupancy of the cell
+  auto step = [&](size_t xFrom, size_t yFrom, size_t x, size_t y) {
+    const value behind = traits::toCompute(visibility(xFrom, yFrom));
+    visibility(x, y) =
+        traits::fromCompute(behind * static_cast<value>(occupancy.get(x, y)));
+  };
+  if (x0 > 0 && window.xBegin == 0) {
+    for (size_t y = window.yBegin; y < window.yEnd; ++y) {
+      visibility(0, y) = traits::fromDouble(0.0);
+    }
+  }
+  if (y0 > 0 && window.yBegin == 0) {
+    std::fill(&visibility(window.xBegin, 0), &visibility(0, 0) + window.xEnd,
+              traits::fromDouble(0.0));
+  }
+  visibility(x0, y0) =
+      traits::fromDouble(lightStrength * occupancy.get(x0, y0));
+  for (size_t x = x0 + 1; x < window.xEnd; ++x) {
+    step(x - 1, y0, x, y0);
+  }
+  for (size_t x = x0 - 1; x > 0 && x < x0 && x >= window.xBegin; --x) {
+    step(x + 1, y0, x, y0);
+  }
+  for (size_t y = y0 + 1; y < window.yEnd; ++y) {
+    step(x0, y - 1, x0, y);
+  }
+  for (size_t y = y0 - 1; y > 0 && y < y0 && y >= window.yBegin; --y) {
+    step(x0, y + 1, x0, y);
+  }
+}
+
+// sweepAxes() over the window of a radius, the whole grid by default
+template <typename T>
+void sweepAxes(Field<T> &visibility, const OccupancyGrid &occupancy,
+               const point &ls, const double lightStrength,
+               const size_t radius = std::numeric_limits<size_t>::max()) {
+  sweepAxes(visibility, occupancy, ls, lightStrength,
+            windowAround(ls, visibility.nx(), visibility.ny(), radius));
+}
+
+/*!
+ * @brief Cells iBegin <= i < iEnd of row j inside the octant below the
+ * diagonal (i < j). They only read the row behind them, so the whole run is
+ * one vector operation. c = i / j is a true divide and the update is not
+ * fused, so the cells match the scalar sweep bit for bit.
+ * @param [out] cur Row being computed, at the source column.
+ * @param [in] prev Row behind it, at the source column.
+ * @param [in] occRow Occupancy words of the row being computed.
+ * @param [in] x0 Source column.
+ * @param [in] dx Step (+1 or -1) away from the source along x.
+ * @param [in] iBegin Start of the run, at least 1.
+ * @param [in] iEnd End of the run.
+ * @param [in] j Row of the run, local to the quadrant.
+ */
+template <typename Pack, typename T>
+inline void sweepOctantRow(T *cur, const T *prev,
+                           const OccupancyGrid::word *occRow, const size_t x0,
+                           const std::ptrdiff_t dx, const size_t iBegin,
+                           const size_t iEnd, const size_t j) {
+  if (iEnd <= iBegin) {
+    return;
+  }
+  using traits = valueTraits<T>;
+  using value = typename traits::compute;
+  constexpr std::ptrdiff_t W = Pack::width;
+  // Walk the run in increasing memory order whatever the quadrant, the
+  // local column index of memory offset m is dx * m.
+  const std::ptrdiff_t mBegin = dx > 0
+                                    ? static_cast<std::ptrdiff_t>(iBegin)
+                                    : 1 - static_cast<std::ptrdiff_t>(iEnd);
+  const std::ptrdiff_t mEnd =
+      mBegin + static_cast<std::ptrdiff_t>(iEnd - iBegin);
+  const Pack step = Pack::set1(static_cast<value>(dx));
+  const Pack row = Pack::set1(static_cast<value>(j));
+  std::ptrdiff_t m = mBegin;
+  for (; m + W <= mEnd; m += W) {
+    const Pack c =
+        (Pack::set1(static_cast<value>(m)) + Pack::iota()) * step / row;
+    const Pack p = Pack::loadu(prev + m);
+    const Pack behind = Pack::loadu(prev + m - dx);
+    const Pack occ = Pack::fromBits(OccupancyGrid::bits(occRow, x0 + m, W));
+    ((p - c * (p - behind)) * occ).storeu(cur + m);
+  }
+  for (; m < mEnd; ++m) {
+    const value c = static_cast<value>(dx * m) / static_cast<value>(j);
+    const value p = traits::toCompute(prev[m]);
+    const value behind = traits::toCompute(prev[m - dx]);
+    const value occ = OccupancyGrid::isFree(occRow, x0 + m);
+    cur[m] = traits::fromCompute((p - c * (p - behind)) * occ);
+  }
+}
+
+/*!
+ * @brief Transport visibility over one quadrant in memory order. Rows are
+ * walked away from the source and each row is a contiguous run of the
+ * row-major Field. A cell at local offset (i, j) only depends on (i - 1, j),
+ * (i, j - 1) and (i - 1, j - 1).
+ *
+ * Rows are processed in strips of Pack::width. Below the diagonal (i < j) a
+ * cell only reads the previous row, so each row of the strip is swept as one
+ * vector run. Above the diagonal (i > j) a cell only reads the previous
+ * column, so once every row of the strip is past the diagonal the strip
+ * advances one column at a time with one lane per row, carrying the column
+ * in a register. Cells near the diagonal are done one by one. Diagonal cells
+ * (i == j) take the value of the cell behind them along y, exactly as the
+ * original column loops did. Every path evaluates a cell the way the scalar
+ * sweep does, v - c * (v - u) with c formed by a divide, so which path
+ * produced a cell never changes its value.
+ *
+ * A strip can be swept over a range of columns only, as long as the columns
+ * before the range are complete for that strip. This is what lets column
+ * blocks of the same quadrant run as a pipeline on several threads.
+ *
+ * Strips are cut into tiles of tileWidth columns. Every cell is a convex
+ * combination of the cells before it times its occupancy, so a tile whose
+ * row before and column before are all dark is dark, and one whose row and
+ * column before are all fully lit and that has no obstacle is fully lit.
+ * Such tiles are filled instead of swept, so the cost of a sweep follows the
+ * area that is neither in shadow nor in full light. Neither the cut into
+ * column blocks nor the cut into tiles changes the values.
+ *
+ * Values are stored as T and computed with valueTraits<T>::compute, see
+ * valueTraits.h.
+ */
+template <typename T, typename Pack = simd::nativePack<T>>
+class QuadrantSweep {
+public:
+  static constexpr size_t W = Pack::width;
+  using traits = valueTraits<T>;
+  using value = typename traits::compute;
+  // Columns of a tile of a strip
+  static constexpr size_t tileWidth = 64;
+
+  // How sweepStrip() produced a tile
+  enum class Tile : std::uint8_t { swept, dark, lit };
+
+  // Number of tiles of a strip that overlap the local columns [iBegin, iEnd)
+  static size_t tilesIn(const size_t iBegin, const size_t iEnd) {
+    return iEnd > iBegin ? (iEnd - 1) / tileWidth - iBegin / tileWidth + 1 : 0;
+  }
+
+  /*!
+   * Constructor.
+   * @param [in, out] visibility Visibility field written by the sweep. Row
+   * 0 and column 0 of the quadrant must have been set by sweepAxes().
+   * @param [in] occupancy Occupancy complement.
+   * @param [in] ls Light source.
+   * @param [in] q Quadrant to sweep.
+   */
+  QuadrantSweep(Field<T> &visibility, const OccupancyGrid &occupancy,
+                const point &ls, const Quadrant &q)
+      : origin_(&visibility(ls.first, ls.second)),
+        occOrigin_(occupancy.row(ls.second)), ls_(ls), q_(q), dx_(q.dx),
+        rowStep_(q.dy * static_cast<std::ptrdiff_t>(visibility.nx())),
+        occRowStep_(q.dy *
+                    static_cast<std::ptrdiff_t>(occupancy.wordsPerRow())) {}
+
+  // Number of strips below the source row.
+  size_t strips() const {
+    return q_.extentY > 1 ? (q_.extentY - 2) / W + 1 : 0;
+  }
+
+  /*!
+   * @brief Sweep strip s over the local columns [iBegin, iEnd). Dark and
+   * fully lit tiles are filled, the others are swept.
+   * @param [out] tiles If not null, tiles[k] is set to how the k-th tile
+   * overlapping [iBegin, iEnd) was produced, tilesIn(iBegin, iEnd) entries.
+   */
+  void sweepStrip(const size_t s, const size_t iBegin, const size_t iEnd,
+                  Tile *tiles = nullptr) const {
+    for (size_t i0 = iBegin; i0 < iEnd;) {
+      const size_t i1 = std::min(iEnd, (i0 / tileWidth + 1) * tileWidth);
+      const Tile tile = classify(s, i0, i1);
+      if (tile == Tile::swept) {
+        sweepRange(s, i0, i1);
+      } else {
+        fill(s, i0, i1, traits::fromDouble(tile == Tile::dark ? 0.0 : 1.0));
+      }
+      if (tiles) {
+        tiles[i0 / tileWidth - iBegin / tileWidth] = tile;
+      }
+      i0 = i1;
+    }
+  }
+
+  /*!
+   * @brief Call onRow(y, xBegin, xEnd) for every row of strip s, or for the
+   * source row if s is npos, restricted to the local columns [iBegin, iEnd)
+   * and to the cells this quadrant owns. Quadrants share their axis rows and
+   * columns, each of those cells is owned by exactly one quadrant so the
+   * callbacks of concurrent quadrants never overlap.
+   * @param [in] tiles If not null, the tiles set by sweepStrip() for the same
+   * strip and columns. Dark tiles are then left out, onRow being called once
+   * per run of other tiles.
+   */
+  template <typename RowOp>
+  void forOwnedRows(const size_t s, const size_t iBegin, const size_t iEnd,
+                    RowOp &&onRow, const Tile *tiles = nullptr) const {
+    // Column 0 belongs to the quadrants walking towards +x, row 0 to the
+    // ones walking towards +y.
+    const size_t a = std::max<size_t>(iBegin, q_.dx > 0 ? 0 : 1);
+    if (a >= iEnd) {
+      return;
+    }
+    // Local columns [b, e) of local row j
+    auto emit = [&](const size_t j, const size_t b, const size_t e) {
+      const size_t xBegin = q_.dx > 0 ? ls_.first + b : ls_.first + 1 - e;
+      const size_t xEnd = q_.dx > 0 ? ls_.first + e : ls_.first + 1 - b;
+      onRow(static_cast<size_t>(ls_.second +
+                                q_.dy * static_cast<std::ptrdiff_t>(j)),
+            xBegin, xEnd);
+    };
+    if (s == npos) {
+      if (q_.dy > 0) {
+        emit(0, a, iEnd);
+      }
+      return;
+    }
+    const size_t j0 = 1 + s * W;
+    const size_t j1 = std::min(j0 + W, q_.extentY);
+    const size_t k0 = iBegin / tileWidth;
+    for (size_t j = j0; j < j1; ++j) {
+      if (!tiles) {
+        emit(j, a, iEnd);
+        continue;
+      }
+      // Runs of tiles that are not dark
+      for (size_t b = a; b < iEnd;) {
+        size_t e = std::min(iEnd, (b / tileWidth + 1) * tileWidth);
+        if (tiles[b / tileWidth - k0] == Tile::dark) {
+          b = e;
+          continue;
+        }
+        while (e < iEnd && tiles[e / tileWidth - k0] != Tile::dark) {
+          e = std::min(iEnd, e + tileWidth);
+        }
+        emit(j, b, e);
+        b = e;
+      }
+    }
+  }
+
+  // Outputs of a tile that other tiles read, see resweepTile()
+  struct TileChange {
+    // Last row, read by the next strip
+    bool lastRow;
+    // Last column, read by the next tile of the strip
+    bool lastColumn;
+  };
+
+  /*!
+   * @brief Produce the tile of strip s over the local columns [i0, i1) again
+   * after its occupancy or the cells before it changed.
+   * @param [in] i0 Start of the tile, a multiple of tileWidth.
+   * @param [in] i1 End of the tile, at most tileWidth past i0.
+   * @return Which of the outputs of the tile changed.
+   */
+  TileChange resweepTile(const size_t s, const size_t i0,
+                         const size_t i1) const {
+    const size_t j0 = 1 + s * W;
+    const size_t h = std::min(W, q_.extentY - j0);
+    const size_t first = std::max<size_t>(i0, 1);
+    if (first >= i1) {
+      return {false, false};
+    }
+    const T *lastRow =
+        origin_ + static_cast<std::ptrdiff_t>(j0 + h - 1) * rowStep_;
+    const T *lastColumn = origin_ +
+                          static_cast<std::ptrdiff_t>(j0) * rowStep_ +
+                          dx_ * static_cast<std::ptrdiff_t>(i1 - 1);
+    T row[tileWidth];
+    T column[W];
+    for (size_t i = first; i < i1; ++i) {
+      row[i - first] = lastRow[dx_ * static_cast<std::ptrdiff_t>(i)];
+    }
+    for (size_t r = 0; r < h; ++r) {
+      column[r] = lastColumn[static_cast<std::ptrdiff_t>(r) * rowStep_];
+    }
+    sweepStrip(s, i0, i1);
+    TileChange change{false, false};
+    for (size_t i = first; i < i1 && !change.lastRow; ++i) {
+      change.lastRow =
+          row[i - first] != lastRow[dx_ * static_cast<std::ptrdiff_t>(i)];
+    }
+    for (size_t r = 0; r < h && !change.lastColumn; ++r) {
+      change.lastColumn =
+          column[r] != lastColumn[static_cast<std::ptrdiff_t>(r) * rowStep_];
+    }
+    return change;
+  }
+
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+private:
+  /*!
+   * @brief How the tile of strip s over the local columns [i0, i1) can be
+   * produced, from the row before the strip, the column before the tile and
+   * the occupancy of the tile. Column 0 is the axis and is part of the tile
+   * when i0 is 0.
+   */
+  Tile classify(const size_t s, const size_t i0, const size_t i1) const {
+    const size_t j0 = 1 + s * W;
+    const size_t h = std::min(W, q_.extentY - j0);
+    const size_t first = std::max<size_t>(i0, 1);
+    if (first >= i1) {
+      return Tile::swept;
+    }
+    const T dark = traits::fromDouble(0.0);
+    const T lit = traits::fromDouble(1.0);
+    bool isDark = true;
+    bool isLit = true;
+    const T *before = origin_ + static_cast<std::ptrdiff_t>(j0 - 1) * rowStep_;
+    for (size_t i = first - 1; i < i1 && (isDark || isLit); ++i) {
+      const T v = before[dx_ * static_cast<std::ptrdiff_t>(i)];
+      isDark &= v == dark;
+      isLit &= v == lit;
+    }
+    for (size_t r = 0; r < h && (isDark || isLit); ++r) {
+      const T v = before[static_cast<std::ptrdiff_t>(r + 1) * rowStep_ +
+                         dx_ * static_cast<std::ptrdiff_t>(first - 1)];
+      isDark &= v == dark;
+      isLit &= v == lit;
+    }
+    if (isDark) {
+      return Tile::dark;
+    }
+    if (!isLit) {
+      return Tile::swept;
+    }
+    const size_t xBegin = dx_ > 0 ? ls_.first + first : ls_.first + 1 - i1;
+    const size_t xEnd = dx_ > 0 ? ls_.first + i1 : ls_.first + 1 - first;
+    for (size_t r = 0; r < h; ++r) {
+      const OccupancyGrid::word *occRow =
+          occOrigin_ + static_cast<std::ptrdiff_t>(j0 + r) * occRowStep_;
+      if (!OccupancyGrid::isFree(occRow, xBegin, xEnd)) {
+        return Tile::swept;
+      }
+    }
+    return Tile::lit;
+  }
+
+  // Set the cells of strip s over the local columns [max(i0, 1), i1) to v
+  void fill(const size_t s, const size_t i0, const size_t i1, const T v) const {
+    const size_t j0 = 1 + s * W;
+    const size_t h = std::min(W, q_.extentY - j0);
+    const size_t first = std::max<size_t>(i0, 1);
+    for (size_t r = 0; r < h; ++r) {
+      T *row = origin_ + static_cast<std::ptrdiff_t>(j0 + r) * rowStep_;
+      if (dx_ > 0) {
+        std::fill(row + first, row + i1, v);
+      } else {
+        std::fill(row + 1 - static_cast<std::ptrdiff_t>(i1),
+                  row + 1 - static_cast<std::ptrdiff_t>(first), v);
+      }
+    }
+  }
+
+  // Sweep strip s over the local columns [iBegin, iEnd), cell by cell.
+  void sweepRange(const size_t s, const size_t iBegin,
+                  const size_t iEnd) const {
+    const size_t j0 = 1 + s * W;
+    const size_t h = std::min(W, q_.extentY - j0);
+    const std::ptrdiff_t stripOffset =
+        static_cast<std::ptrdiff_t>(j0) * rowStep_;
+    // Columns before nearEnd are done row by row, the rest lane by lane.
+    // A partial strip is done row by row all the way.
+    const size_t nearEnd = h == W ? std::min(j0 + W, q_.extentX) : q_.extentX;
+    const size_t first = std::max<size_t>(iBegin, 1);
+
+    for (size_t r = 0; r < h; ++r) {
+      const size_t j = j0 + r;
+      T *cur =
+          origin_ + stripOffset + static_cast<std::ptrdiff_t>(r) * rowStep_;
+      const T *prev = cur - rowStep_;
+      const OccupancyGrid::word *occRow =
+          occOrigin_ + static_cast<std::ptrdiff_t>(j) * occRowStep_;
+
+      sweepOctantRow<Pack>(cur, prev, occRow, ls_.first, dx_, first,
+                           std::min(j, iEnd), j);
+      for (size_t i = std::max(j, first); i < std::min(nearEnd, iEnd); ++i) {
+        const std::ptrdiff_t o = dx_ * static_cast<std::ptrdiff_t>(i);
+        value v;
+        if (i == j) {
+          v = traits::toCompute(prev[o]);
+        } else {
+          const value c = static_cast<value>(j) / static_cast<value>(i);
+          const value left = traits::toCompute(cur[o - dx_]);
+          v = left - c * (left - traits::toCompute(prev[o - dx_]));
+        }
+        const value occ = OccupancyGrid::isFree(occRow, ls_.first + o);
+        cur[o] = traits::fromCompute(v * occ);
+      }
+    }
+
+    const size_t laneBegin = std::max(nearEnd, first);
+    if (laneBegin < iEnd) {
+      T *strip = origin_ + stripOffset;
+      const OccupancyGrid::word *occStrip =
+          occOrigin_ + static_cast<std::ptrdiff_t>(j0) * occRowStep_;
+      const T *above = strip - rowStep_;
+      const Pack rows = Pack::set1(static_cast<value>(j0)) + Pack::iota();
+      Pack column = Pack::gather(
+          strip + dx_ * static_cast<std::ptrdiff_t>(laneBegin - 1), rowStep_);
+      for (size_t i = laneBegin; i < iEnd; ++i) {
+        const std::ptrdiff_t o = dx_ * static_cast<std::ptrdiff_t>(i);
+        // v = (left - c * (left - upperLeft)) * occupancy, c = j / i
+        std::uint32_t bits = 0;
+        for (size_t r = 0; r < W; ++r) {
+          bits |= static_cast<std::uint32_t>(OccupancyGrid::isFree(
+                      occStrip + static_cast<std::ptrdiff_t>(r) * occRowStep_,
+                      ls_.first + o))
+                  << r;
+        }
+        const Pack occ = Pack::fromBits(bits);
+        const Pack c = rows / Pack::set1(static_cast<value>(i));
+        const Pack upperLeft =
+            column.shiftIn(traits::toCompute(above[o - dx_]));
+        column = (column - c * (column - upperLeft)) * occ;
+        column.scatter(strip + o, rowStep_);
+      }
+    }
+  }
+
+  T *origin_;
+  // Occupancy words of the source row
+  const OccupancyGrid::word *occOrigin_;
+  point ls_;
+  Quadrant q_;
+  std::ptrdiff_t dx_;
+  std::ptrdiff_t rowStep_;
+  std::ptrdiff_t occRowStep_;
+};
+
+/*!
+ * @brief Sweep one quadrant on the calling thread. The axes must have been
+ * set by sweepAxes().
+ * @param [in, out] visibility Visibility field written by the sweep.
+ * @param [in] occupancy Occupancy complement.
+ * @param [in] ls Light source.
+ * @param [in] q Quadrant to sweep.
+ * @param [in] onRow Called as onRow(y, xBegin, xEnd) once row y is complete
+ * over the half-open range [xBegin, xEnd) of cells owned by the quadrant,
+ * dark tiles left out.
+ */
+template <typename T, typename Pack = simd::nativePack<T>, typename RowOp>
+void sweepQuadrant(Field<T> &visibility, const OccupancyGrid &occupancy,
+                   const point &ls, const Quadrant &q, RowOp &&onRow) {
+  if (q.extentX == 0 || q.extentY == 0) {
+    return;
+  }
+  using Sweep = QuadrantSweep<T, Pack>;
+  const Sweep sweep(visibility, occupancy, ls, q);
+  std::vector<typename Sweep::Tile> tiles(Sweep::tilesIn(0, q.extentX));
+  sweep.forOwnedRows(sweep.npos, 0, q.extentX, onRow);
+  for (size_t s = 0; s < sweep.strips(); ++s) {
+    sweep.sweepStrip(s, 0, q.extentX, tiles.data());
+    sweep.forOwnedRows(s, 0, q.extentX, onRow, tiles.data());
+  }
+}
+
+/*!
+ * @brief Repair one quadrant of a visibility field after a few cells changed.
+ * A tile of a strip only depends on its occupancy, the row before the strip
+ * and the column before the tile. So only the tiles holding a changed cell
+ * are produced again, and a tile passes the repair on to the tiles after it
+ * only if its last row or last column changed. The work follows the wedge
+ * whose visibility actually changed rather than the quadrant. The axes must
+ * be up to date.
+ * @param [in, out] visibility Visibility field of the light source, swept
+ * before the change.
+ * @param [in] occupancy Occupancy complement after the change.
+ * @param [in] ls Light source.
+ * @param [in] q Quadrant to repair.
+ * @param [in] cells Local columns and rows (i, j) of the cells of the quadrant
+ * whose occupancy changed, or whose visibility changed on the axes.
+ * @return Number of tiles produced again.
+ */
+template <typename T, typename Pack = simd::nativePack<T>>
+size_t repairQuadrant(Field<T> &visibility, const OccupancyGrid &occupancy,
+                      const point &ls, const Quadrant &q,
+                      const std::vector<std::pair<size_t, size_t>> &cells) {
+  if (q.extentX == 0 || q.extentY == 0) {
+    return 0;
+  }
+  using Sweep = QuadrantSweep<T, Pack>;
+  const Sweep sweep(visibility, occupancy, ls, q);
+  const size_t strips = sweep.strips();
+  const size_t tiles = Sweep::tilesIn(0, q.extentX);
+  std::vector<std::uint8_t> dirty(strips * tiles, 0);
+  auto mark = [&](const size_t s, const size_t k) {
+    if (s < strips && k < tiles) {
+      dirty[s * tiles + k] = 1;
+    }
+  };
+  for (const auto &[i, j] : cells) {
+    if (j == 0) {
+      // Row before the first strip, read by the tiles over [i0 - 1, i1)
+      mark(0, i / Sweep::tileWidth);
+      mark(0, (i + 1) / Sweep::tileWidth);
+    } else {
+      mark((j - 1) / Sweep::W, i / Sweep::tileWidth);
+      if (i == 0) {
+        // Column 0 is never swept, it can be the last row of a strip
+        mark(j / Sweep::W, 0);
+      }
+    }
+  }
+
+  size_t resweeps = 0;
+  for (size_t s = 0; s < strips; ++s) {
+    for (size_t k = 0; k < tiles; ++k) {
+      if (!dirty[s * tiles + k]) {
+        continue;
+      }
+      const auto change =
+          sweep.resweepTile(s, k * Sweep::tileWidth,
+                            std::min((k + 1) * Sweep::tileWidth, q.extentX));
+      ++resweeps;
+      if (change.lastRow) {
+        mark(s + 1, k);
+        mark(s + 1, k + 1);
+      }
+      if (change.lastColumn) {
+        mark(s, k + 1);
+      }
+    }
+  }
+  return resweeps;
+}
+
+} // namespace vbs
+
+#endif // QUADRANTSWEEP_H
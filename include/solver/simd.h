@@ -0,0 +1,333 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include "solver/valueTraits.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+namespace vbs {
+namespace simd {
+
+// A pack holds width lanes of valueTraits<T>::compute. It is loaded from and
+// stored to visibility values of type T, converting on the way.
+
+// Portable scalar pack of width 1. Used as the fallback when no vector
+// instruction set is available and for benchmarking against it.
+template <typename T> struct scalarPack {
+  using value = typename valueTraits<T>::compute;
+  static constexpr std::size_t width = 1;
+  value v;
+
+  static scalarPack set1(value s) { return {s}; }
+  // Lane k holds k
+  static scalarPack iota() { return {value(0)}; }
+  static scalarPack loadu(const T *p) {
+    return {valueTraits<T>::toCompute(*p)};
+  }
+  void storeu(T *p) const { *p = valueTraits<T>::fromCompute(v); }
+  // Lane k is 1 if bit k is set, 0 otherwise
+  static scalarPack fromBits(std::uint32_t bits) { return {value(bits & 1)}; }
+  // Lane k is read from / written to p[k * stride]
+  static scalarPack gather(const T *p, std::ptrdiff_t) { return loadu(p); }
+  void scatter(T *p, std::ptrdiff_t) const { storeu(p); }
+  // Lanes move up by one, s enters lane 0
+  scalarPack shiftIn(value s) const { return {s}; }
+
+  friend scalarPack operator+(scalarPack a, scalarPack b) { return {a.v + b.v}; }
+  friend scalarPack operator-(scalarPack a, scalarPack b) { return {a.v - b.v}; }
+  friend scalarPack operator*(scalarPack a, scalarPack b) { return {a.v * b.v}; }
+  friend scalarPack operator/(scalarPack a, scalarPack b) { return {a.v / b.v}; }
+  friend scalarPack sqrt(scalarPack a) { return {std::sqrt(a.v)}; }
+};
+
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+// 8 double lanes
+struct avx512PackDouble {
+  using value = double;
+  static constexpr std::size_t width = 8;
+  __m512d v;
+
+  static avx512PackDouble set1(double s) { return {_mm512_set1_pd(s)}; }
+  static avx512PackDouble iota() {
+    return {_mm512_set_pd(7.0, 6.0, 5.0, 4.0, 3.0, 2.0, 1.0, 0.0)};
+  }
+  static avx512PackDouble loadu(const double *p) {
+    return {_mm512_loadu_pd(p)};
+  }
+  void storeu(double *p) const { _mm512_storeu_pd(p, v); }
+  static avx512PackDouble fromBits(std::uint32_t bits) {
+    return {_mm512_maskz_mov_pd(static_cast<__mmask8>(bits),
+                                _mm512_set1_pd(1.0))};
+  }
+  static __m512i strides(std::ptrdiff_t stride) {
+    return _mm512_mullo_epi64(_mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0),
+                              _mm512_set1_epi64(stride));
+  }
+  static avx512PackDouble gather(const double *p, std::ptrdiff_t stride) {
+    return {_mm512_mask_i64gather_pd(_mm512_setzero_pd(), 0xFF,
+                                     strides(stride), p, sizeof(double))};
+  }
+  void scatter(double *p, std::ptrdiff_t stride) const {
+    _mm512_i64scatter_pd(p, strides(stride), v, sizeof(double));
+  }
+  avx512PackDouble shiftIn(double s) const {
+    const __m512i up = _mm512_set_epi64(6, 5, 4, 3, 2, 1, 0, 0);
+    return {_mm512_mask_permutexvar_pd(_mm512_set1_pd(s), 0xFE, up, v)};
+  }
+
+  friend avx512PackDouble operator+(avx512PackDouble a, avx512PackDouble b) {
+    return {_mm512_add_pd(a.v, b.v)};
+  }
+  friend avx512PackDouble operator-(avx512PackDouble a, avx512PackDouble b) {
+    return {_mm512_sub_pd(a.v, b.v)};
+  }
+  friend avx512PackDouble operator*(avx512PackDouble a, avx512PackDouble b) {
+    return {_mm512_mul_pd(a.v, b.v)};
+  }
+  friend avx512PackDouble operator/(avx512PackDouble a, avx512PackDouble b) {
+    return {_mm512_div_pd(a.v, b.v)};
+  }
+  friend avx512PackDouble sqrt(avx512PackDouble a) {
+    // All-lanes maskz form, see avx512PackFloat::loadu
+    return {_mm512_maskz_sqrt_pd(0xFF, a.v)};
+  }
+};
+
+// 16 float lanes, stored as float or as 16-bit fixed point
+template <typename T> struct avx512PackFloat {
+  using value = float;
+  static constexpr std::size_t width = 16;
+  __m512 v;
+
+  static avx512PackFloat set1(float s) { return {_mm512_set1_ps(s)}; }
+  static avx512PackFloat iota() {
+    return {_mm512_set_ps(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1,
+                          0)};
+  }
+  static avx512PackFloat loadu(const T *p) {
+    if constexpr (std::is_same_v<T, float>) {
+      return {_mm512_loadu_ps(p)};
+    } else {
+      // All-lanes masked forms, the unmasked ones start from an undefined
+      // register that GCC flags as maybe uninitialized
+      const __m512i raw = _mm512_maskz_cvtepu16_epi32(
+          0xFFFF, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)));
+      return {_mm512_mul_ps(_mm512_maskz_cvtepi32_ps(0xFFFF, raw),
+                            _mm512_set1_ps(1.0f / valueTraits<T>::scale))};
+    }
+  }
+  void storeu(T *p) const {
+    if constexpr (std::is_same_v<T, float>) {
+      _mm512_storeu_ps(p, v);
+    } else {
+      const __m512 clamped = _mm512_maskz_min_ps(
+          0xFFFF, _mm512_maskz_max_ps(0xFFFF, v, _mm512_setzero_ps()),
+          _mm512_set1_ps(1.0f));
+      const __m512i raw = _mm512_maskz_cvtps_epi32(
+          0xFFFF,
+          _mm512_mul_ps(clamped, _mm512_set1_ps(valueTraits<T>::scale)));
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(p),
+                          _mm512_maskz_cvtusepi32_epi16(0xFFFF, raw));
+    }
+  }
+  static avx512PackFloat fromBits(std::uint32_t bits) {
+    return {_mm512_maskz_mov_ps(static_cast<__mmask16>(bits),
+                                _mm512_set1_ps(1.0f))};
+  }
+  static avx512PackFloat gather(const T *p, std::ptrdiff_t stride) {
+    if constexpr (std::is_same_v<T, float>) {
+      const __m512i offsets = _mm512_mullo_epi32(
+          _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1,
+                           0),
+          _mm512_set1_epi32(static_cast<int>(stride)));
+      return {_mm512_mask_i32gather_ps(_mm512_setzero_ps(), 0xFFFF, offsets,
+                                       p, sizeof(float))};
+    } else {
+      alignas(64) T lanes[width];
+      for (std::size_t k = 0; k < width; ++k) {
+        lanes[k] = p[static_cast<std::ptrdiff_t>(k) * stride];
+      }
+      return loadu(lanes);
+    }
+  }
+  void scatter(T *p, std::ptrdiff_t stride) const {
+    alignas(64) T lanes[width];
+    storeu(lanes);
+    for (std::size_t k = 0; k < width; ++k) {
+      p[static_cast<std::ptrdiff_t>(k) * stride] = lanes[k];
+    }
+  }
+  avx512PackFloat shiftIn(float s) const {
+    const __m512i up = _mm512_set_epi32(14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4,
+                                        3, 2, 1, 0, 0);
+    return {_mm512_mask_permutexvar_ps(_mm512_set1_ps(s), 0xFFFE, up, v)};
+  }
+
+  friend avx512PackFloat operator+(avx512PackFloat a, avx512PackFloat b) {
+    return {_mm512_add_ps(a.v, b.v)};
+  }
+  friend avx512PackFloat operator-(avx512PackFloat a, avx512PackFloat b) {
+    return {_mm512_sub_ps(a.v, b.v)};
+  }
+  friend avx512PackFloat operator*(avx512PackFloat a, avx512PackFloat b) {
+    return {_mm512_mul_ps(a.v, b.v)};
+  }
+  friend avx512PackFloat operator/(avx512PackFloat a, avx512PackFloat b) {
+    return {_mm512_div_ps(a.v, b.v)};
+  }
+};
+
+template <typename T>
+using avx512Pack = std::conditional_t<std::is_same_v<T, double>,
+                                      avx512PackDouble, avx512PackFloat<T>>;
+#endif
+
+#if defined(__AVX2__)
+// 4 double lanes
+struct avx2PackDouble {
+  using value = double;
+  static constexpr std::size_t width = 4;
+  __m256d v;
+
+  static avx2PackDouble set1(double s) { return {_mm256_set1_pd(s)}; }
+  static avx2PackDouble iota() { return {_mm256_set_pd(3.0, 2.0, 1.0, 0.0)}; }
+  static avx2PackDouble loadu(const double *p) { return {_mm256_loadu_pd(p)}; }
+  void storeu(double *p) const { _mm256_storeu_pd(p, v); }
+  static avx2PackDouble fromBits(std::uint32_t bits) {
+    const __m256i lanes = _mm256_set_epi64x(8, 4, 2, 1);
+    const __m256i set = _mm256_cmpeq_epi64(
+        _mm256_and_si256(_mm256_set1_epi64x(bits), lanes), lanes);
+    return {_mm256_and_pd(_mm256_castsi256_pd(set), _mm256_set1_pd(1.0))};
+  }
+  static avx2PackDouble gather(const double *p, std::ptrdiff_t stride) {
+    return {_mm256_set_pd(p[3 * stride], p[2 * stride], p[stride], p[0])};
+  }
+  void scatter(double *p, std::ptrdiff_t stride) const {
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, v);
+    p[0] = lanes[0];
+    p[stride] = lanes[1];
+    p[2 * stride] = lanes[2];
+    p[3 * stride] = lanes[3];
+  }
+  avx2PackDouble shiftIn(double s) const {
+    return {_mm256_blend_pd(_mm256_permute4x64_pd(v, 0x90),
+                            _mm256_set1_pd(s), 0x1)};
+  }
+
+  friend avx2PackDouble operator+(avx2PackDouble a, avx2PackDouble b) {
+    return {_mm256_add_pd(a.v, b.v)};
+  }
+  friend avx2PackDouble operator-(avx2PackDouble a, avx2PackDouble b) {
+    return {_mm256_sub_pd(a.v, b.v)};
+  }
+  friend avx2PackDouble operator*(avx2PackDouble a, avx2PackDouble b) {
+    return {_mm256_mul_pd(a.v, b.v)};
+  }
+  friend avx2PackDouble operator/(avx2PackDouble a, avx2PackDouble b) {
+    return {_mm256_div_pd(a.v, b.v)};
+  }
+  friend avx2PackDouble sqrt(avx2PackDouble a) {
+    return {_mm256_sqrt_pd(a.v)};
+  }
+};
+
+// 8 float lanes, stored as float or as 16-bit fixed point
+template <typename T> struct avx2PackFloat {
+  using value = float;
+  static constexpr std::size_t width = 8;
+  __m256 v;
+
+  static avx2PackFloat set1(float s) { return {_mm256_set1_ps(s)}; }
+  static avx2PackFloat iota() {
+    return {_mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0)};
+  }
+  static avx2PackFloat loadu(const T *p) {
+    if constexpr (std::is_same_v<T, float>) {
+      return {_mm256_loadu_ps(p)};
+    } else {
+      const __m256i raw = _mm256_cvtepu16_epi32(
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+      return {_mm256_mul_ps(_mm256_cvtepi32_ps(raw),
+                            _mm256_set1_ps(1.0f / valueTraits<T>::scale))};
+    }
+  }
+  void storeu(T *p) const {
+    if constexpr (std::is_same_v<T, float>) {
+      _mm256_storeu_ps(p, v);
+    } else {
+      const __m256 clamped = _mm256_min_ps(
+          _mm256_max_ps(v, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+      const __m256i raw = _mm256_cvtps_epi32(
+          _mm256_mul_ps(clamped, _mm256_set1_ps(valueTraits<T>::scale)));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(p),
+                       _mm_packus_epi32(_mm256_castsi256_si128(raw),
+                                        _mm256_extracti128_si256(raw, 1)));
+    }
+  }
+  static avx2PackFloat fromBits(std::uint32_t bits) {
+    const __m256i lanes = _mm256_set_epi32(128, 64, 32, 16, 8, 4, 2, 1);
+    const __m256i set = _mm256_cmpeq_epi32(
+        _mm256_and_si256(_mm256_set1_epi32(static_cast<int>(bits)), lanes),
+        lanes);
+    return {_mm256_and_ps(_mm256_castsi256_ps(set), _mm256_set1_ps(1.0f))};
+  }
+  static avx2PackFloat gather(const T *p, std::ptrdiff_t stride) {
+    alignas(32) T lanes[width];
+    for (std::size_t k = 0; k < width; ++k) {
+      lanes[k] = p[static_cast<std::ptrdiff_t>(k) * stride];
+    }
+    return loadu(lanes);
+  }
+  void scatter(T *p, std::ptrdiff_t stride) const {
+    alignas(32) T lanes[width];
+    storeu(lanes);
+    for (std::size_t k = 0; k < width; ++k) {
+      p[static_cast<std::ptrdiff_t>(k) * stride] = lanes[k];
+    }
+  }
+  avx2PackFloat shiftIn(float s) const {
+    const __m256i up = _mm256_set_epi32(6, 5, 4, 3, 2, 1, 0, 0);
+    return {_mm256_blend_ps(_mm256_permutevar8x32_ps(v, up),
+                            _mm256_set1_ps(s), 0x1)};
+  }
+
+  friend avx2PackFloat operator+(avx2PackFloat a, avx2PackFloat b) {
+    return {_mm256_add_ps(a.v, b.v)};
+  }
+  friend avx2PackFloat operator-(avx2PackFloat a, avx2PackFloat b) {
+    return {_mm256_sub_ps(a.v, b.v)};
+  }
+  friend avx2PackFloat operator*(avx2PackFloat a, avx2PackFloat b) {
+    return {_mm256_mul_ps(a.v, b.v)};
+  }
+  friend avx2PackFloat operator/(avx2PackFloat a, avx2PackFloat b) {
+    return {_mm256_div_ps(a.v, b.v)};
+  }
+};
+
+template <typename T>
+using avx2Pack = std::conditional_t<std::is_same_v<T, double>, avx2PackDouble,
+                                    avx2PackFloat<T>>;
+#endif
+
+// Widest pack supported by the target the code is compiled for
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+template <typename T> using nativePack = avx512Pack<T>;
+#elif defined(__AVX2__)
+template <typename T> using nativePack = avx2Pack<T>;
+#else
+template <typename T> using nativePack = scalarPack<T>;
+#endif
+
+} // namespace simd
+} // namespace vbs
+
+#endif // SIMD_H
@@ -0,0 +1,80 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace vbs {
+
+// Fork-join pool of persistent worker threads. Tasks of a run are claimed in
+// increasing index order, so a task may wait on a task with a lower index
+// without risking a deadlock.
+class ThreadPool {
+public:
+  /*!
+   * Constructor.
+   * @brief Start the workers. The calling thread takes part in every run, so
+   * a pool of size 1 has no worker and runs everything inline.
+   * @param [in] threads Total number of threads, 0 for all hardware threads.
+   */
+  explicit ThreadPool(std::size_t threads);
+  // Deconstructor, joins the workers
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // Number of threads taking part in a run, caller included
+  inline std::size_t size() const { return workers_.size() + 1; }
+
+  /*!
+   * @brief Run task(k) for every k in [0, tasks) and wait for all of them.
+   * The task is called through a reference, so a run does not allocate.
+   * @param [in] tasks Number of tasks.
+   * @param [in] task Task body, any callable taking the index.
+   */
+  template <typename Task> void run(const std::size_t tasks, Task &&task) {
+    using Body = std::remove_reference_t<Task>;
+    runTask(tasks, TaskRef{std::addressof(task),
+                           [](const void *body, const std::size_t k) {
+                             (*static_cast<const Body *>(body))(k);
+                           }});
+  }
+
+private:
+  // Task body of a run, borrowed for its duration
+  struct TaskRef {
+    const void *body;
+    void (*call)(const void *body, std::size_t k);
+    inline void operator()(const std::size_t k) const { call(body, k); }
+  };
+
+  void runTask(std::size_t tasks, const TaskRef &task);
+  void work();
+  void drain(const TaskRef &task, std::size_t tasks);
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+
+  // Current run, guarded by mutex_
+  const TaskRef *task_ = nullptr;
+  std::size_t tasks_ = 0;
+  std::size_t generation_ = 0;
+  std::size_t active_ = 0;
+  bool stop_ = false;
+
+  std::atomic<std::size_t> next_{0};
+  std::atomic<std::size_t> pending_{0};
+};
+
+} // namespace vbs
+
+#endif // THREADPOOL_H
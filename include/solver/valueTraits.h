@@ -0,0 +1,56 @@
+#ifndef VALUETRAITS_H
+#define VALUETRAITS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace vbs {
+
+// 16-bit fixed-point visibility, 0 is dark and 65535 is fully lit.
+using fixed16 = std::uint16_t;
+
+/*!
+ * @brief How visibility values of type T are stored and computed with.
+ * Visibility is bounded in [0, 1], so besides double it can be held in
+ * float or in 16-bit fixed point to cut the memory traffic of the sweeps.
+ * compute is the arithmetic type of the sweep for T.
+ */
+template <typename T> struct valueTraits;
+
+template <> struct valueTraits<double> {
+  using compute = double;
+  static constexpr const char *name = "double";
+  static compute toCompute(double v) { return v; }
+  static double fromCompute(compute v) { return v; }
+  static double toDouble(double v) { return v; }
+  static double fromDouble(double v) { return v; }
+};
+
+template <> struct valueTraits<float> {
+  using compute = float;
+  static constexpr const char *name = "float";
+  static compute toCompute(float v) { return v; }
+  static float fromCompute(compute v) { return v; }
+  static double toDouble(float v) { return v; }
+  static float fromDouble(double v) { return static_cast<float>(v); }
+};
+
+template <> struct valueTraits<fixed16> {
+  using compute = float;
+  static constexpr const char *name = "fixed16";
+  static constexpr float scale = 65535.0f;
+  static compute toCompute(fixed16 v) { return v * (1.0f / scale); }
+  static fixed16 fromCompute(compute v) {
+    // Round to nearest even, as the vector conversions do
+    return static_cast<fixed16>(std::lrint(std::clamp(v, 0.0f, 1.0f) * scale));
+  }
+  static double toDouble(fixed16 v) { return v / 65535.0; }
+  static fixed16 fromDouble(double v) {
+    return fromCompute(static_cast<float>(v));
+  }
+};
+
+} // namespace vbs
+
+#endif // VALUETRAITS_H
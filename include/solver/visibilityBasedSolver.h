@@ -2,26 +2,48 @@
 #define VISIBILITYBASEDSOLVER_H
 
 #include "environment/environment.h"
+#include "environment/gridWriter.h"
+#include "solver/asyncWriter.h"
+#include "solver/cornerRoadmap.h"
+#include "solver/frontierQueue.h"
+#include "solver/lazyVisibility.h"
+#include "solver/parallelSweep.h"
+#include "solver/pivotIndex.h"
 
 #include <cmath>
-#include <queue>
+#include <cstdint>
+#include <limits>
+#include <optional>
 #include <vector>
 
-#include <SFML/Graphics.hpp>
-
 namespace vbs {
 
-// Node structure that is maintained by the heap: a double distance value for
-// every x, y size_t values
-struct Node {
-  size_t x, y;
-  double h;
-
-  bool operator<(const Node &other) const { return h > other.h; }
+// Time spent in each phase of one planner iteration, in us
+struct IterationTiming {
+  // Clearing the local visibility and transporting along the axes
+  double reset;
+  // Quadrant sweeps, with the fold into the global visibility and the pivot
+  // candidate updates of every row fused in
+  double sweep;
+  // Update of the pivot index
+  double select;
+  // Candidate cells whose heuristic changed
+  size_t changed;
+  // Tiles of the pivot index that had to be rescanned
+  size_t rescans;
+  // New candidates whose heuristic was computed, rescans aside
+  size_t scored;
 };
 
-class visibilityBasedSolver {
+/*!
+ * @brief Visibility-based path planner. Visibility is stored as T, one of
+ * double, float or fixed16 (see valueTraits.h), and the sweeps compute in the
+ * matching precision. Results are written out as double whatever T is.
+ */
+template <typename T = double> class visibilityBasedSolver {
 public:
+  using traits = valueTraits<T>;
+
   /*!
    * Constructor.
    * @brief Initialize the solver with an environment.
@@ -34,9 +56,33 @@ public:
   // Get global iterator (number of iterations that had to be completed)
   inline int getGlobalIter() const { return globalIter; };
 
-  // Solve
+  // Solve. The results are written in the background, see flushResults().
   void solve();
 
+  /*!
+   * @brief Solve from start to goal without printing or saving anything, e.g.
+   * for repeated queries on a resident solver. The maps of the previous solve
+   * are cleared in place and the scratch of the sweeps is kept, so once the
+   * solver has seen queries of a size it allocates nothing for them (see
+   * tests/steadyStateAllocations.cpp). The solver is the workspace of one
+   * query at a time, there is no pool of them: concurrent queries use one
+   * solver each, as libvbs does with one per planner. Nor are the maps
+   * cleared lazily with generation counters, restart() writes the window the
+   * last solve touched. Coordinates are cells of the grid, they are not
+   * flipped in image mode.
+   * @param [in] start Start cell.
+   * @param [in] goal Goal cell.
+   * @param [out] path Start, the light sources passed and goal, empty if no
+   * path was found.
+   * @return Length of the path, infinite if start or goal is out of the grid
+   * or occupied or no path was found.
+   */
+  double solve(const point &start, const point &goal,
+               std::vector<point> &path);
+
+  // Wait until the results of every solve so far are written
+  void flushResults() { writer_->flush(); }
+
   // Compute standAloneVisibility
   void standAloneVisibility();
 
@@ -60,6 +106,16 @@ public:
    */
   void benchmarkSeries();
 
+  /*!
+   * @brief Benchmark the row-major quadrant sweep, with the scalar pack and
+   * with the widest vector pack of the target on the configured number of
+   * threads, against the original
+   * column-major loops on the loaded environment. Reports time, cell
+   * throughput, effective bandwidth and the largest difference to the
+   * original result.
+   */
+  void benchmarkTraversal();
+
   /*!
    * @brief Compute visibility using a typical raycasting algorithm. Enumerate
    * in a map the number of times each cell is traveresed.
@@ -70,22 +126,224 @@ public:
    */
   void raycasting(int x0, int y0, int x1, int y1);
 
+  /*!
+   * @brief Compute the stand-alone visibility of a light source, without
+   * saving anything. The result is available from getVisibility().
+   * @param [in] source Light source, must be in the grid.
+   */
+  void computeVisibility(const point &source);
+
+  /*!
+   * @brief Compute the stand-alone visibility of a directional light source,
+   * e.g. a sensor with a limited field of view. Only the quadrants the sector
+   * meets are swept, each cut to the rows and columns the sector needs, so a
+   * narrow sector costs a fraction of a full sweep. Cells of the sector get
+   * the values computeVisibility(source) gives them, the others are 0.
+   * @param [in] source Light source, must be in the grid.
+   * @param [in] heading Direction of the sector in radians, from the x axis
+   * towards the y axis.
+   * @param [in] aperture Full angle of the sector in radians.
+   */
+  void computeVisibility(const point &source, double heading,
+                         double aperture);
+
+  /*!
+   * @brief Limit the range of the light sources of the following sweeps and
+   * solves. Cells further than radius from a source get no light and only
+   * the window of that radius around it is swept, so a sweep costs the
+   * square of the radius rather than the grid. Set from the config.
+   * @param [in] radius Range in cells, 0 for the whole grid.
+   * @param [in] decay Visibility is scaled by exp(-decay * d) at distance d
+   * from the source, 0 for no decay.
+   */
+  void setRange(double radius, double decay = 0);
+
+  // Visibility of the last light source
+  inline const Field<T> &getVisibility() const { return visibility_; }
+  // Global visibility of the last solve, the highest of its light sources
+  inline const Field<T> &getGlobalVisibility() const {
+    return visibility_global_;
+  }
+  // Light source each cell of the last solve came from, by index
+  inline const Field<size_t> &getCameFrom() const { return cameFrom_; }
+  // Light sources of the last solve, in the order of the cameFrom indices
+  inline const point *getLightSources() const { return lightSources_.data(); }
+  inline size_t getNbOfSources() const { return nb_of_sources_; }
+
+  /*!
+   * @brief Repair the visibility of the last light source after cells of the
+   * environment changed with environment::updateCells(). Only the part of
+   * the quadrants downstream of the changed cells whose visibility changes
+   * is swept again, the result is the same as computing it from scratch.
+   * With a limited range or decay (see setRange()) the window of the range
+   * is swept again whole, and after a directional source the sector is.
+   * @param [in] updates Cells that changed.
+   * @return Number of tiles swept again, 0 if the window was.
+   */
+  size_t repairVisibility(const std::vector<CellUpdate> &updates);
+
+  /*!
+   * @brief Repair a visibility field kept from before cells of the
+   * environment changed, e.g. one from computeVisibilityBatch().
+   * @param [in] updates Cells that changed.
+   * @param [in] source Light source of the field, must be in the grid.
+   * @param [in, out] field Visibility of the source before the change.
+   * @return Number of tiles swept again, 0 if the window was.
+   */
+  size_t repairVisibility(const std::vector<CellUpdate> &updates,
+                          const point &source, Field<T> &field) const;
+
+  // Visibility of a batch of light sources reduced over the sources
+  struct Coverage {
+    // Highest visibility of any source
+    Field<T> visibility;
+    // Number of sources whose visibility is at least the threshold
+    Field<std::uint32_t> count;
+  };
+
+  /*!
+   * @brief Compute the stand-alone visibility of a batch of light sources.
+   * Sources are spread over the threads and every thread sweeps its sources
+   * one after the other, so the bit-packed occupancy is read from its cache
+   * rather than from memory after the first one.
+   * @param [in] sources Light sources, must be in the grid.
+   * @param [out] fields fields[k] is the visibility of sources[k]. Resized to
+   * the number of sources, fields of the right dimensions are reused.
+   */
+  void computeVisibilityBatch(const std::vector<point> &sources,
+                              std::vector<Field<T>> &fields);
+
+  /*!
+   * @brief Compute the visibility of a batch of light sources reduced into
+   * coverage maps, without keeping the field of every source. Each thread
+   * folds the rows of its sources into its own maps as they are swept, and
+   * the maps of the threads are merged at the end.
+   * @param [in] sources Light sources, must be in the grid.
+   * @param [in] threshold Visibility from which a source counts as seeing a
+   * cell, greater than 0.
+   * @param [out] coverage Coverage of the sources, resized to the grid.
+   */
+  void computeVisibilityBatch(const std::vector<point> &sources,
+                              double threshold, Coverage &coverage);
+
+  /*!
+   * @brief Benchmark the batch visibility of random free cells of the loaded
+   * environment against computing and reducing them one at a time with
+   * computeVisibility().
+   * @param [in] nbSources Number of light sources.
+   */
+  void benchmarkBatch(size_t nbSources = 256);
+
+  /*!
+   * @brief Visibility of cell b from light source a, as computeVisibility(a)
+   * gives it up to rounding, range and decay included. Only the cells b
+   * depends on are evaluated, the ones between a and b in a cone along the
+   * characteristic of b, so a query costs the square of the distance from a
+   * to b at worst instead of the grid. Evaluated cells are kept for the
+   * following queries from the same source until the occupancy changes.
+   * @param [in] a Light source, must be in the grid.
+   * @param [in] b Cell, must be in the grid.
+   */
+  double visibilityBetween(const point &a, const point &b);
+
+  // true if the visibility of b from a is at least the visibility threshold
+  inline bool isVisible(const point &a, const point &b) {
+    return visibilityBetween(a, b) >= visibilityThreshold_;
+  }
+
+  /*!
+   * @brief Benchmark visibilityBetween() on pairs of random free cells of
+   * the loaded environment against raycasting() and against a sweep per
+   * pair, then on many cells seen from one source against a single sweep.
+   * @param [in] nbQueries Number of pairs, and of cells seen from the source.
+   */
+  void benchmarkVisibilityBetween(size_t nbQueries = 1000);
+
+  /*!
+   * @brief Build the roadmap of the convex obstacle corners of the
+   * environment (see CornerRoadmap). Every corner is swept once, in batches
+   * over the threads, and corners are linked at the visibility threshold.
+   * @param [out] roadmap Roadmap of the current occupancy.
+   */
+  void buildRoadmap(CornerRoadmap &roadmap);
+
+  /*!
+   * @brief Shortest path from start to goal over a roadmap. The start and
+   * the goal are swept once each to find the corners they see, and the path
+   * is searched over the roadmap. Coordinates are cells of the grid, they are
+   * not flipped in image mode.
+   * @param [in] roadmap Roadmap of the current occupancy.
+   * @param [in] start Start cell, must be in the grid.
+   * @param [in] goal Goal cell, must be in the grid.
+   * @param [out] path Start, the corners passed and goal, empty if there is
+   * no path.
+   * @return Length of the path, infinite if there is none.
+   */
+  double solveOnRoadmap(const CornerRoadmap &roadmap, const point &start,
+                        const point &goal, std::vector<point> &path);
+
+  /*!
+   * @brief Benchmark the roadmap of the loaded environment: its build, save
+   * and load, then queries between random free cells.
+   * @param [in] nbQueries Number of queries.
+   */
+  void benchmarkRoadmap(size_t nbQueries = 100);
+
 private:
   void reset();
-  std::shared_ptr<Field<double>> occupancyComplement_;
-  Field<double> visibility_global_;
-  Field<double> visibility_;
+  // Occupancy complement, shared with the environment
+  std::shared_ptr<OccupancyGrid> occupancyComplement_;
+  Field<T> visibility_global_;
+  Field<T> visibility_;
   Field<double> visibilityRayCasting_;
   Field<size_t> cameFrom_;
-  Field<bool> isUpdated_;
+  // Light sources of the current solve. They are no pivot candidates, as
+  // lighting one again changes nothing and would pick it forever.
+  Field<bool> isLightSource_;
 
-  std::unique_ptr<point[]> lightSources_;
+  // Light sources of the current solve, max_iter + 2 of them at most
+  std::vector<point> lightSources_;
 
   std::shared_ptr<Config> sharedConfig_;
 
-  std::unique_ptr<sf::Image> uniqueLoadedImage_;
+  // Goal distance fields, shared with the environment
+  std::shared_ptr<GoalDistanceCache> goalDistanceCache_;
+  // Goal distance field of the last solve, null when no pivot is picked
+  std::shared_ptr<const Field<double>> goalDistance_;
+  // Convex obstacle corners, shared with the environment
+  std::shared_ptr<const CornerIndex> cornerIndex_;
+  // Only corner cells are pivot candidates, see Config::cornerPivots. Cleared
+  // when the corner pivots fail and the solve is run again.
+  bool cornerPivots_ = false;
 
   void reconstructPath(const Node &current, std::vector<point> &resultingPath);
+  // Path from the start to goal through cameFrom_, returns its length
+  double tracePath(const point &goal, std::vector<point> &resultingPath);
+
+  // Pick light sources from start until end is visible enough, false if it
+  // cannot be, with a message unless silent. With corner pivots, a search
+  // that fails is run again scoring every cell, so the corners never fail a
+  // solve that full scoring gets through.
+  bool plan(const point &start, const point &end);
+  // One search of plan() with the current candidates, false once no
+  // candidate is left or max_iter is hit. Silent with corner pivots.
+  bool search(const point &start, const point &end);
+  // Clear what the previous plan() wrote to the maps, in place
+  void restart();
+  // Extend folded_ to hold window, ignored if it is empty
+  inline void markFolded(const Window &window) {
+    if (window.xBegin >= window.xEnd || window.yBegin >= window.yEnd) {
+      return;
+    }
+    if (folded_.xBegin == folded_.xEnd) {
+      folded_ = window;
+      return;
+    }
+    folded_ = {std::min(folded_.xBegin, window.xBegin),
+               std::max(folded_.xEnd, window.xEnd),
+               std::min(folded_.yBegin, window.yBegin),
+               std::max(folded_.yEnd, window.yEnd)};
+  }
 
   // Dimensions.
   size_t ny_;
@@ -114,36 +372,246 @@ private:
                 (source_y - target_y) * (source_y - target_y));
   };
 
-  // Reset queue
-  void resetQueue();
+  /*!
+   * @brief Heuristic of cells as pivots: their global visibility scaled, plus
+   * the distances to the goal and to the light source they came from. It only
+   * changes when the global visibility of a cell rises. The goal distance is
+   * read from goalDistance_ and the parent distance is computed a pack at a
+   * time.
+   * @param [in] y Row of the cells.
+   * @param [in] x0 First cell.
+   * @param [in] x1 End of the cells, at most PivotIndex::tileSize past x0.
+   * @param [out] h h[x - x0] is the heuristic of cell x, infinite if it is not
+   * visible enough to be a pivot, is a light source already or, with corner
+   * pivots, is no corner cell. Holds PivotIndex::tileSize values.
+   */
+  void heuristics(size_t y, size_t x0, size_t x1, double *h);
+
+  // Corner cells x0, ..., x1 - 1 of row y as the low bits of the result, or
+  // every cell without corner pivots
+  inline std::uint32_t eligible(const size_t y, const size_t x0,
+                                const size_t x1) const {
+    return cornerPivots_ ? cornerIndex_->bits(y, x0, x1 - x0)
+                         : ~std::uint32_t(0);
+  }
 
-  // visibility update
+  // Visibility update. Sweeps the visibility of ls_, folds it into the
+  // global visibility and, while solving, picks the next pivot into pivot_.
   void updateVisibility();
 
+  // Print the mean of iterationTimings_
+  void printIterationTimings() const;
+
   // Stand-alone visibility computation (Algorithm 1 in the paper). More
   // suitable for sparse environments.
   void computeVisibility();
 
+  /*!
+   * @brief Sweep the visibility of a source into a field on the calling
+   * thread.
+   * @param [out] field Visibility field, of the grid dimensions.
+   * @param [in] source Light source.
+   * @param [in] onRow Called as onRow(y, xBegin, xEnd) for every completed
+   * run of a row, dark tiles left out.
+   */
+  template <typename RowOp>
+  void sweepSource(Field<T> &field, const point &source, RowOp &&onRow) const {
+    const size_t radius = windowRadius();
+    sweepAxes(field, *occupancyComplement_, source, lightStrength_, radius);
+    for (const auto &quadrant : quadrantsAround(source, nx_, ny_, radius)) {
+      sweepQuadrant(field, *occupancyComplement_, source, quadrant, onRow);
+    }
+  }
+
+  // true if the range or the decay of the light is limited
+  inline bool isRanged() const { return radius_ > 0 || decay_ > 0; }
+
+  // Half width of the window swept around a light source
+  inline size_t windowRadius() const {
+    return radius_ > 0 ? static_cast<size_t>(radius_)
+                       : std::numeric_limits<size_t>::max();
+  }
+
+  /*!
+   * @brief Visibility of a cell once the range and the decay of the light
+   * are applied.
+   * @param [in] x x position of the cell
+   * @param [in] y y position of the cell
+   * @param [in] source Light source.
+   * @param [in] v Visibility transported from the source.
+   */
+  inline T ranged(const size_t x, const size_t y, const point &source,
+                  const T v) const {
+    if (!isInRange(x, y, source)) {
+      return traits::fromDouble(0.0);
+    }
+    if (decay_ > 0 && traits::toDouble(v) > 0) {
+      const double dx = static_cast<double>(x) - source.first;
+      const double dy = static_cast<double>(y) - source.second;
+      const double d = std::sqrt(dx * dx + dy * dy);
+      return traits::fromDouble(traits::toDouble(v) * std::exp(-decay_ * d));
+    }
+    return v;
+  }
+
+  // true if the cell is within the range of the light of the source
+  inline bool isInRange(const size_t x, const size_t y,
+                        const point &source) const {
+    const double dx = static_cast<double>(x) - source.first;
+    const double dy = static_cast<double>(y) - source.second;
+    return radius_ == 0 || dx * dx + dy * dy <= radius_ * radius_;
+  }
+
+  /*!
+   * @brief Apply the range and the decay of the light to the cells of a
+   * window of a visibility field.
+   * @param [in] sector If not null, cells outside of it are darkened too.
+   */
+  void applyRange(Field<T> &field, const point &source, const Window &window,
+                  const Sector *sector = nullptr) const;
+
+  // Sweep the visibility of ls_ within a sector into visibility_, see
+  // computeVisibility(source, heading, aperture)
+  void sweepSector(const Sector &sector);
+
+  // Start a sweep of ls_ into visibility_: clear the cells the last sweep
+  // wrote if the new one may not cover them and transport along the axes.
+  // Returns the window the sweep covers.
+  Window startSweep();
+
+  // startSweep() over a window, partial if it is not the whole grid or if
+  // the sweep leaves cells of it to applyRange()
+  void startSweep(const Window &window, bool partial);
+
+  // Clear the cells of visibility_ written by the last sweep, except those
+  // of keep
+  void clearSwept(const Window &keep = {0, 0, 0, 0});
+
+  // Original column-major quadrant loops, kept as a reference for
+  // benchmarkTraversal().
+  void computeVisibilityColumnMajor();
+
   /*!
    * @brief Stand-alone visibility computation using a queue. It has termination
-   * conditions. generalized. More suitable for denser environments.
+   * conditions. generalized. More suitable for denser environments. Only the
+   * cells reached by the frontier are written, they are listed in frontier_
+   * until the next call. The propagation stops below the queue cutoff.
    */
   void computeVisibilityUsingQueue();
 
-  // Save results
-  void saveResults() const;
-  void saveImageWithPath(const std::vector<point> &path) const;
+  // Change of the heuristic of a cell when its visibility is folded in
+  enum class CellChange {
+    // Unchanged, or the cell is still not a candidate
+    none,
+    // The cell became a candidate
+    fresh,
+    // The cell was a candidate and its heuristic rose
+    risen
+  };
 
-  // Heap to maintain the heuristic
-  std::unique_ptr<std::priority_queue<Node>> heap_;
+  /*!
+   * @brief Fold the visibility of a cell into the global visibility and the
+   * parent map.
+   * @param [in] x x position of the cell
+   * @param [in] y y position of the cell
+   */
+  inline CellChange foldCell(const size_t x, const size_t y) {
+    const T v = visibility_(x, y);
+    T &global = visibility_global_(x, y);
+    if (traits::toDouble(v) >= visibilityThreshold_) {
+      if (cameFrom_(x, y) == 1e15) {
+        cameFrom_(x, y) = nb_of_sources_;
+      }
+    }
+    if (!(v > global)) {
+      return CellChange::none;
+    }
+    const bool wasCandidate = traits::toDouble(global) >= visibilityThreshold_;
+    global = v;
+    if (wasCandidate) {
+      return CellChange::risen;
+    }
+    return traits::toDouble(v) >= visibilityThreshold_ ? CellChange::fresh
+                                                       : CellChange::none;
+  }
+
+  // State of a solve that saveResults() writes, copied when the solve ends
+  // so that the writer thread does not race the next one. Only the parts the
+  // config saves are filled.
+  struct Results {
+    Field<size_t> cameFrom;
+    Field<T> visibilityGlobal;
+    Field<T> visibility;
+    OccupancyGrid occupancy;
+    std::vector<point> lightSources;
+    std::vector<IterationTiming> iterationTimings;
+  };
+
+  // Save results. The state is copied and written by writer_.
+  void saveResults() const;
+  void writeResults(const Results &results) const;
+  // Draw path over the map, occupancy being a copy taken with the path
+  void saveImageWithPath(const std::vector<point> &path,
+                         const OccupancyGrid &occupancy) const;
+
+  // Change to one tile of the pivot index found while folding a row: the
+  // best new candidate of the row in the tile, or the tile best got worse.
+  struct TileUpdate {
+    size_t tile;
+    Node best;
+    bool invalidate;
+  };
+  // Tile updates and number of changed and scored candidates of every column
+  // block of the sweep, each on its own cache line as blocks fill them
+  // concurrently. Kept across iterations so the vectors keep their capacity.
+  struct alignas(64) BlockUpdates {
+    std::vector<TileUpdate> updates;
+    size_t changed;
+    size_t scored;
+  };
+  std::vector<BlockUpdates> blockUpdates_;
+  // Blocks and scratch of the parallel sweep, kept across sweeps
+  SweepWorkspace<T> sweepWorkspace_;
+  // Best candidate of every tile, carried from one iteration to the next
+  PivotIndex pivotIndex_;
+  // Frontier of computeVisibilityUsingQueue(), kept for its storage and for
+  // the list of reached cells
+  FrontierQueue frontier_;
+  // Cells evaluated by visibilityBetween()
+  LazyVisibility<T> lazyVisibility_;
+  // Next pivot, h is infinite if no cell is a candidate
+  Node pivot_;
+  // Timing of every iteration of the last solve
+  std::vector<IterationTiming> iterationTimings_;
+
+  // Threads running the visibility sweeps
+  std::unique_ptr<ThreadPool> pool_;
+  // Visibility of every thread of computeVisibilityBatch() and coverage of
+  // every thread but the first, which folds into the result. Kept for their
+  // storage.
+  std::vector<Field<T>> batchVisibility_;
+  std::vector<Coverage> batchCoverage_;
 
   // Number of lightsources/pivots.
   size_t nb_of_sources_ = 0;
-  // Lightstrength, can be decreased. Can add later an alpha that has light
-  // decay, enforcing adding a new pivot periodically.
+  // Lightstrength, can be decreased. The range and decay of the light below
+  // make the planner add pivots more often.
   const double lightStrength_ = 1.0;
+  // Range of the light in cells, 0 for the whole grid
+  double radius_ = 0;
+  // Decay of the visibility per cell of distance to the source
+  double decay_ = 0;
+  // Cells of visibility_ written by the last sweep
+  Window swept_{0, 0, 0, 0};
+  // Sector of the last sweep, none if it covered every direction
+  std::optional<Sector> sector_;
+  // Cells of the global visibility, the parent map and the light source map
+  // written since the last restart(), which only clears those
+  Window folded_{0, 0, 0, 0};
   // Visibility threshold
   double visibilityThreshold_;
+  // Visibility below which computeVisibilityUsingQueue() stops propagating
+  static constexpr double queueCutoff = 0.001;
   // Ratio used in PDE update.
   double c_ = 1.0;
   // Global iterator.
@@ -172,6 +640,10 @@ private:
 
   // For scaling the visibility in the heuristic
   double scale_ = 0;
+
+  // Writes the results of the solves in the background. Last member, so it
+  // is destroyed first and its pending jobs still see the others.
+  std::unique_ptr<AsyncWriter> writer_;
 };
 
 } // namespace vbs
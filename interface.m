@@ -55,9 +55,7 @@ for i = 1:2:length(settingsCell{1})
 end
 
 %% Visibility field (basically occupancy grid)
-filename_visibilityField = "output/visibilityField.txt";
-T_visibilityField = readtable(filename_visibilityField,'Delimiter',' ');
-visibilityField = T_visibilityField.Variables;
+visibilityField = readGrid("output/visibilityField", settings);
 plotVisibilityField = true;
 
 if plotVisibilityField
@@ -80,9 +78,7 @@ if plotVisibilityField
 end
 
 %% cameFrom
-filename_cameFrom = "output/cameFrom.txt";
-T = readtable(filename_cameFrom, 'Delimiter',' ');
-cameFrom = T.Variables + 1;
+cameFrom = readGrid("output/cameFrom", settings) + 1;
 plotCameFrom = false;
 
 if plotCameFrom
@@ -104,9 +100,7 @@ if plotCameFrom
 end
 
 %% Visibility heuristic path planning plots
-filename_visibility = "output/VisibilityMap.txt";
-T_visibility = readtable(filename_visibility,'Delimiter',' ');
-map_visibility = T_visibility.Variables;
+map_visibility = readGrid("output/VisibilityMap", settings);
 
 figure(2)
 set(gcf, 'Name', 'Visibility heuristic path planning')
@@ -174,4 +168,57 @@ set(gca,'LooseInset',get(gca,'TightInset'));
 
 %% Expfig
 % addpath(genpath('MATLAB_code/expfig'))
-% export_fig misc_example -r400 -transparent -jpg
\ No newline at end of file
+% export_fig misc_example -r400 -transparent -jpg
+
+%% Readers
+% Grid saved by the solver, from stem.npy if settings.outputFormat is 1 and
+% from stem.txt otherwise
+function grid = readGrid(stem, settings)
+    if isfield(settings, 'outputFormat') && settings.outputFormat == 1
+        grid = readNpy(stem + ".npy");
+    else
+        T = readtable(stem + ".txt", 'Delimiter', ' ');
+        grid = T.Variables;
+    end
+end
+
+% 2D array of a .npy file as double, rows and columns as in NumPy
+function grid = readNpy(filename)
+    fid = fopen(filename, 'r', 'ieee-le');
+    if fid < 0
+        error('Failed to open %s', filename);
+    end
+    cleanup = onCleanup(@() fclose(fid));
+    magic = fread(fid, 6, 'uint8=>char')';
+    if ~strcmp(magic(2:end), 'NUMPY')
+        error('%s is not a .npy file', filename);
+    end
+    version = fread(fid, 2, 'uint8');
+    if version(1) == 1
+        headerLength = fread(fid, 1, 'uint16');
+    else
+        headerLength = fread(fid, 1, 'uint32');
+    end
+    header = fread(fid, headerLength, 'uint8=>char')';
+    % e.g. {'descr': '<f8', 'fortran_order': False, 'shape': (1000, 1000), }
+    descr = regexp(header, '''descr'':\s*''([<>|])([fiub])(\d+)''', ...
+        'tokens', 'once');
+    shape = str2double(regexp(extractAfter(header, '''shape'''), ...
+        '\d+', 'match'));
+    bits = 8 * str2double(descr{3});
+    switch descr{2}
+        case 'f'
+            precision = sprintf('float%d', bits);
+        case 'i'
+            precision = sprintf('int%d', bits);
+        otherwise
+            precision = sprintf('uint%d', bits);
+    end
+    machine = 'ieee-le';
+    if descr{1} == '>'
+        machine = 'ieee-be';
+    end
+    data = fread(fid, prod(shape), [precision '=>double'], 0, machine);
+    % Rows are contiguous in the file, MATLAB fills columns first
+    grid = reshape(data, fliplr(shape))';
+end
@@ -0,0 +1,80 @@
+#include "solver/asyncWriter.h"
+
+namespace vbs {
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+AsyncWriter::AsyncWriter(std::size_t depth) : depth_(depth) {
+  if (depth_ > 0) {
+    thread_ = std::thread(&AsyncWriter::work, this);
+  }
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+AsyncWriter::~AsyncWriter() {
+  if (!thread_.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  thread_.join();
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+void AsyncWriter::submit(std::function<void()> job) {
+  if (depth_ == 0) {
+    job();
+    return;
+  }
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return jobs_.size() < depth_; });
+    jobs_.push_back(std::move(job));
+  }
+  wake_.notify_one();
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+void AsyncWriter::flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [this] { return jobs_.empty() && !busy_; });
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+void AsyncWriter::work() {
+  while (true) {
+    std::function<void()> job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      // Waiting jobs still run on stop, so nothing submitted is lost
+      wake_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+      if (jobs_.empty()) {
+        return;
+      }
+      job = std::move(jobs_.front());
+      jobs_.pop_front();
+      busy_ = true;
+    }
+    done_.notify_all();
+    job();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      busy_ = false;
+    }
+    done_.notify_all();
+  }
+}
+
+} // namespace vbs
@@ -0,0 +1,260 @@
+#include "solver/cornerRoadmap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <queue>
+
+namespace vbs {
+
+namespace {
+
+// Start of a roadmap file, the last character is the format version
+constexpr char magic[8] = {'V', 'B', 'S', 'R', 'M', 'A', 'P', '1'};
+
+// Fixed part of a roadmap file, followed by the corners as pairs of int32,
+// the nodes + 1 row offsets and the targets as uint32
+struct fileHeader {
+  char magic[8];
+  std::uint64_t nx;
+  std::uint64_t ny;
+  std::uint64_t fingerprint;
+  double threshold;
+  std::uint64_t nodes;
+  std::uint64_t targets;
+};
+
+inline double distance(const point &a, const point &b) {
+  const double dx = a.first - b.first;
+  const double dy = a.second - b.second;
+  return std::sqrt(dx * dx + dy * dy);
+}
+
+} // namespace
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+void CornerRoadmap::assign(
+    const OccupancyGrid &occupancy, const double threshold,
+    std::vector<point> nodes,
+    const std::vector<std::vector<std::uint32_t>> &links) {
+  nx_ = occupancy.nx();
+  ny_ = occupancy.ny();
+  revision_ = occupancy.revision();
+  fingerprint_ = fingerprint(occupancy);
+  threshold_ = threshold;
+  nodes_ = std::move(nodes);
+  offsets_.assign(1, 0);
+  targets_.clear();
+  for (const auto &targets : links) {
+    targets_.insert(targets_.end(), targets.begin(), targets.end());
+    offsets_.push_back(static_cast<std::uint32_t>(targets_.size()));
+  }
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+void CornerRoadmap::clear() {
+  nx_ = ny_ = revision_ = 0;
+  fingerprint_ = 0;
+  threshold_ = 0;
+  nodes_.clear();
+  offsets_.assign(1, 0);
+  targets_.clear();
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+bool CornerRoadmap::save(const std::string &filename) const {
+  std::ofstream of(filename, std::ios::out | std::ios::binary |
+                                 std::ios::trunc);
+  if (!of.is_open()) {
+    std::cerr << "Failed to open output file " << filename << std::endl;
+    return false;
+  }
+  fileHeader header;
+  std::memcpy(header.magic, magic, sizeof(magic));
+  header.nx = nx_;
+  header.ny = ny_;
+  header.fingerprint = fingerprint_;
+  header.threshold = threshold_;
+  header.nodes = nodes_.size();
+  header.targets = targets_.size();
+  of.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  for (const point &node : nodes_) {
+    const std::int32_t xy[2] = {node.first, node.second};
+    of.write(reinterpret_cast<const char *>(xy), sizeof(xy));
+  }
+  of.write(reinterpret_cast<const char *>(offsets_.data()),
+           offsets_.size() * sizeof(std::uint32_t));
+  of.write(reinterpret_cast<const char *>(targets_.data()),
+           targets_.size() * sizeof(std::uint32_t));
+  if (!of) {
+    std::cerr << "Failed to write roadmap " << filename << std::endl;
+    return false;
+  }
+  return true;
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+bool CornerRoadmap::load(const std::string &filename,
+                         const OccupancyGrid &occupancy) {
+  clear();
+  std::ifstream in(filename, std::ios::in | std::ios::binary);
+  if (!in.is_open()) {
+    std::cerr << "Failed to open roadmap " << filename << std::endl;
+    return false;
+  }
+  fileHeader header;
+  in.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!in || std::memcmp(header.magic, magic, sizeof(magic)) != 0) {
+    std::cerr << "Not a roadmap file " << filename << std::endl;
+    return false;
+  }
+  if (header.nx != occupancy.nx() || header.ny != occupancy.ny() ||
+      header.fingerprint != fingerprint(occupancy)) {
+    std::cerr << "Roadmap " << filename << " was built on another map"
+              << std::endl;
+    return false;
+  }
+  std::vector<std::int32_t> xy(2 * header.nodes);
+  offsets_.resize(header.nodes + 1);
+  targets_.resize(header.targets);
+  in.read(reinterpret_cast<char *>(xy.data()),
+          xy.size() * sizeof(std::int32_t));
+  in.read(reinterpret_cast<char *>(offsets_.data()),
+          offsets_.size() * sizeof(std::uint32_t));
+  in.read(reinterpret_cast<char *>(targets_.data()),
+          targets_.size() * sizeof(std::uint32_t));
+  const bool consistent =
+      in && offsets_.front() == 0 && offsets_.back() == header.targets &&
+      std::is_sorted(offsets_.begin(), offsets_.end()) &&
+      std::all_of(targets_.begin(), targets_.end(),
+                  [&](std::uint32_t t) { return t < header.nodes; });
+  if (!consistent) {
+    std::cerr << "Roadmap " << filename << " is truncated or corrupt"
+              << std::endl;
+    clear();
+    return false;
+  }
+  nodes_.resize(header.nodes);
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    nodes_[i] = {xy[2 * i], xy[2 * i + 1]};
+  }
+  nx_ = occupancy.nx();
+  ny_ = occupancy.ny();
+  revision_ = occupancy.revision();
+  fingerprint_ = header.fingerprint;
+  threshold_ = header.threshold;
+  return true;
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+double CornerRoadmap::search(const point &start, const point &goal,
+                             const std::vector<std::uint32_t> &fromStart,
+                             const std::vector<std::uint32_t> &toGoal,
+                             std::vector<point> &path) const {
+  // Corners are nodes 0 to n - 1, the start is node n and the goal node n + 1
+  const std::uint32_t n = static_cast<std::uint32_t>(nodes_.size());
+  const std::uint32_t startNode = n;
+  const std::uint32_t goalNode = n + 1;
+  auto position = [&](const std::uint32_t i) -> const point & {
+    return i == startNode ? start : (i == goalNode ? goal : nodes_[i]);
+  };
+  std::vector<char> seesGoal(n, 0);
+  for (const std::uint32_t i : toGoal) {
+    seesGoal[i] = 1;
+  }
+
+  constexpr double inf = std::numeric_limits<double>::infinity();
+  std::vector<double> g(n + 2, inf);
+  std::vector<std::uint32_t> cameFrom(n + 2, startNode);
+  std::vector<char> closed(n + 2, 0);
+  using entry = std::pair<double, std::uint32_t>;
+  std::priority_queue<entry, std::vector<entry>, std::greater<entry>> open;
+  g[startNode] = 0;
+  open.push({distance(start, goal), startNode});
+  auto relax = [&](const std::uint32_t from, const std::uint32_t to) {
+    const double candidate = g[from] + distance(position(from), position(to));
+    if (candidate < g[to]) {
+      g[to] = candidate;
+      cameFrom[to] = from;
+      open.push({candidate + distance(position(to), goal), to});
+    }
+  };
+  while (!open.empty()) {
+    const std::uint32_t current = open.top().second;
+    open.pop();
+    if (closed[current]) {
+      continue;
+    }
+    closed[current] = 1;
+    if (current == goalNode) {
+      break;
+    }
+    if (current == startNode) {
+      for (const std::uint32_t i : fromStart) {
+        relax(current, i);
+      }
+      continue;
+    }
+    for (std::uint32_t k = offsets_[current]; k < offsets_[current + 1]; ++k) {
+      relax(current, targets_[k]);
+    }
+    if (seesGoal[current]) {
+      relax(current, goalNode);
+    }
+  }
+
+  path.clear();
+  if (g[goalNode] == inf) {
+    return inf;
+  }
+  for (std::uint32_t i = goalNode; i != startNode; i = cameFrom[i]) {
+    path.push_back(position(i));
+  }
+  path.push_back(start);
+  std::reverse(path.begin(), path.end());
+  // A start or goal on a corner is passed twice
+  path.erase(std::unique(path.begin(), path.end()), path.end());
+  return g[goalNode];
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+std::uint64_t CornerRoadmap::fingerprint(const OccupancyGrid &occupancy) {
+  // FNV-1a a word at a time over the dimensions and the rows, without the
+  // bits past the end of a row
+  std::uint64_t hash = 0xcbf29ce484222325ull;
+  auto mix = [&](const std::uint64_t value) {
+    hash = (hash ^ value) * 0x100000001b3ull;
+  };
+  mix(occupancy.nx());
+  mix(occupancy.ny());
+  const size_t words = occupancy.wordsPerRow();
+  const size_t tail = occupancy.nx() % OccupancyGrid::wordBits;
+  const OccupancyGrid::word last =
+      tail == 0 ? ~OccupancyGrid::word(0)
+                : (OccupancyGrid::word(1) << tail) - 1;
+  for (size_t y = 0; y < occupancy.ny(); ++y) {
+    const OccupancyGrid::word *row = occupancy.row(y);
+    for (size_t w = 0; w < words; ++w) {
+      mix(w + 1 == words ? row[w] & last : row[w]);
+    }
+  }
+  return hash;
+}
+
+} // namespace vbs
@@ -1,11 +1,13 @@
 #include "environment/environment.h"
+#include "environment/mapLoader.h"
+#include "render/image.h"
 
 #include <algorithm>
+#include <cctype>
 
 #include <chrono>
 #include <fstream>
 #include <iostream>
-#include <sstream>
 
 namespace vbs {
 
@@ -13,7 +15,9 @@ namespace vbs {
 /*****************************************************************************/
 /*****************************************************************************/
 environment::environment(Config &config)
-    : sharedConfig_(std::make_shared<Config>(config)) {
+    : sharedConfig_(std::make_shared<Config>(config)),
+      sharedGoalDistance_(std::make_shared<GoalDistanceCache>()),
+      sharedCornerIndex_(std::make_shared<CornerIndex>()) {
   if (sharedConfig_->mode == 1) {
     nx_ = sharedConfig_->ncols;
     ny_ = sharedConfig_->nrows;
@@ -26,14 +30,26 @@ environment::environment(Config &config)
       saveEnvironment();
     }
   } else if (sharedConfig_->mode == 2) {
-    // loadMaps(sharedConfig_->imagePath);
-    loadImage(sharedConfig_->imagePath);
+    loadMap(sharedConfig_->imagePath);
     if (sharedConfig_->saveResults) {
       saveEnvironment();
     }
   }
 }
 
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+environment::environment(Config &config,
+                         std::shared_ptr<OccupancyGrid> occupancy)
+    : ny_(occupancy->ny()), nx_(occupancy->nx()),
+      sharedVisibilityField_(std::move(occupancy)),
+      sharedConfig_(std::make_shared<Config>(config)),
+      sharedGoalDistance_(std::make_shared<GoalDistanceCache>()),
+      sharedCornerIndex_(std::make_shared<CornerIndex>()) {
+  indexCorners();
+}
+
 /*****************************************************************************/
 /*****************************************************************************/
 /*****************************************************************************/
@@ -72,11 +88,11 @@ void environment::generateNewEnvironmentFromSettings() {
 
     for (int j = col_1; j < col_2; ++j) {
       for (int k = row_1; k < row_2; ++k) {
-        sharedVisibilityField_->set(j, k, 0);
-        sharedSpeedField_->set(j, k, speedValue_);
+        sharedVisibilityField_->set(j, k, false);
       }
     }
   }
+  indexCorners();
 
   if (!sharedConfig_->silent) {
     std::cout << "########################### Environment output "
@@ -115,11 +131,11 @@ void environment::generateNewEnvironment(size_t ncols, size_t nrows,
 
     for (int j = col_1; j < col_2; ++j) {
       for (int k = row_1; k < row_2; ++k) {
-        sharedVisibilityField_->set(j, k, 0);
-        sharedSpeedField_->set(j, k, speedValue_);
+        sharedVisibilityField_->set(j, k, false);
       }
     }
   }
+  indexCorners();
   if (!sharedConfig_->silent) {
     std::cout << "########################### Environment output "
                  "############################ \n"
@@ -131,83 +147,100 @@ void environment::generateNewEnvironment(size_t ncols, size_t nrows,
   }
 }
 
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+void environment::updateCells(const std::vector<CellUpdate> &updates) {
+  for (const auto &update : updates) {
+    if (update.x >= nx_ || update.y >= ny_) {
+      std::cerr << "Cell update (" << update.x << ", " << update.y
+                << ") is out of bounds, skipped" << std::endl;
+      continue;
+    }
+    sharedVisibilityField_->set(update.x, update.y, update.free);
+    sharedCornerIndex_->update(*sharedVisibilityField_, update.y);
+  }
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+void environment::occupancyChanged() {
+  sharedVisibilityField_->touch();
+  indexCorners();
+}
+
 /*****************************************************************************/
 /*****************************************************************************/
 /*****************************************************************************/
 void environment::loadMaps(const std::string &filename) {
-  std::ifstream input(filename);
-  std::vector<std::vector<float>> visibilityField;
-  for (std::string line; std::getline(input, line);) {
-    std::vector<float> floatVector = stringToFloatVector(line, ' ');
-    visibilityField.push_back(floatVector);
+  auto occupancy = std::make_shared<OccupancyGrid>();
+  ThreadPool pool(sharedConfig_->threads);
+  if (!loadTextMap(filename, *occupancy, pool)) {
+    std::cout << "Error: Failed to load map" << std::endl;
+    return;
   }
-  nx_ = visibilityField.size();
-  ny_ = visibilityField[0].size();
-  std::cout << "Loaded vector of dimensions " << nx_ << "x" << ny_
+  nx_ = occupancy->nx();
+  ny_ = occupancy->ny();
+  sharedVisibilityField_ = occupancy;
+  indexCorners();
+  std::cout << "Loaded map of dimensions " << nx_ << "x" << ny_
             << " successfully" << std::endl;
+}
 
-  // Resets environment
-  resetEnvironment();
-
-  for (size_t i = 0; i < nx_; ++i) {
-    for (size_t j = 0; j < ny_; ++j) {
-      sharedVisibilityField_->set(i, j, visibilityField[i][j]);
-      if (visibilityField[i][j] == 1.0) {
-        sharedSpeedField_->set(i, j, 1.0);
-      } else {
-        sharedSpeedField_->set(i, j, speedValue_);
-      }
-    }
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+void environment::loadNetpbm(const std::string &filename) {
+  auto occupancy = std::make_shared<OccupancyGrid>();
+  ThreadPool pool(sharedConfig_->threads);
+  if (!vbs::loadNetpbm(filename, *occupancy, pool)) {
+    std::cout << "Error: Failed to load map" << std::endl;
+    return;
   }
-  std::cout << "Loaded image of dimensions " << nx_ << "x" << ny_
+  nx_ = occupancy->nx();
+  ny_ = occupancy->ny();
+  sharedVisibilityField_ = occupancy;
+  indexCorners();
+  std::cout << "Loaded map of dimensions " << nx_ << "x" << ny_
             << " successfully" << std::endl;
 }
 
 /*****************************************************************************/
 /*****************************************************************************/
 /*****************************************************************************/
-std::vector<float> environment::stringToFloatVector(const std::string &str,
-                                                    char delimiter) {
-  std::vector<float> floatVector;
-  std::stringstream ss(str);
-  std::string item;
-  while (std::getline(ss, item, delimiter)) {
-    floatVector.push_back(std::stof(item));
+void environment::loadMap(const std::string &filename) {
+  std::string extension = std::filesystem::path(filename).extension().string();
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  if (extension == ".pgm" || extension == ".pbm") {
+    loadNetpbm(filename);
+  } else if (extension == ".txt") {
+    loadMaps(filename);
+  } else {
+    loadImage(filename);
   }
-  return floatVector;
 }
 
 /*****************************************************************************/
 /*****************************************************************************/
 /*****************************************************************************/
 void environment::loadImage(const std::string &filename) {
-  uniqueLoadedImage_.reset(std::make_unique<sf::Image>().release());
-  // Load the image from a file
-  if (!uniqueLoadedImage_->loadFromFile(filename)) {
+  // Load the image from a file, decoded only for as long as it is packed
+  Image image;
+  if (!vbs::loadImage(filename, image)) {
     std::cout << "Error: Failed to load image" << std::endl;
   } else {
-    auto size = uniqueLoadedImage_->getSize();
-    nx_ = size.x;
-    ny_ = size.y;
+    nx_ = image.width();
+    ny_ = image.height();
 
     resetEnvironment();
 
-    sf::Color color;
-    int gray;
-    // Access the pixel data of the image
-    for (size_t x = 0; x < nx_; ++x) {
-      for (size_t y = 0; y < ny_; ++y) {
-        color = uniqueLoadedImage_->getPixel(x, y);
-        gray = color.r;
-        if (gray == 255) {
-          sharedVisibilityField_->set(x, y, 1.0);
-          sharedSpeedField_->set(x, y, 1.0);
-        } else {
-          sharedVisibilityField_->set(x, y, 0);
-          sharedSpeedField_->set(x, y, speedValue_);
-        }
-      }
-    }
+    // Free cells are white, read off the red channel of the RGBA pixels
+    ThreadPool pool(sharedConfig_->threads);
+    packPixels(image.getPixelsPtr(), 4, 255,
+               *sharedVisibilityField_, pool);
+    indexCorners();
     std::cout << "Loaded image of dimensions " << nx_ << "x" << ny_
               << " successfully" << std::endl;
   }
@@ -217,8 +250,14 @@ void environment::loadImage(const std::string &filename) {
 /*****************************************************************************/
 /*****************************************************************************/
 void environment::resetEnvironment() {
-  sharedVisibilityField_ = std::make_shared<Field<double>>(nx_, ny_, 1.0);
-  sharedSpeedField_ = std::make_shared<Field<double>>(nx_, ny_, 1.0);
+  sharedVisibilityField_ = std::make_shared<OccupancyGrid>(nx_, ny_, true);
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+void environment::indexCorners() {
+  sharedCornerIndex_->build(*sharedVisibilityField_);
 }
 
 /*****************************************************************************/
@@ -238,21 +277,15 @@ void environment::saveEnvironment() {
     }
   }
 
-  // save visibility field
+  // save visibility field, top row first
   if (sharedConfig_->saveVisibilityField) {
-    std::fstream of(outputFilePath, std::ios::out | std::ios::trunc);
-    if (!of.is_open()) {
-      std::cerr << "Failed to open output file " << outputFilePath << std::endl;
+    if (!writeGrid<bool>("./output/visibilityField",
+                         static_cast<OutputFormat>(sharedConfig_->outputFormat),
+                         nx_, ny_, true, [this](size_t x, size_t y) {
+                           return sharedVisibilityField_->get(x, y);
+                         })) {
       return;
     }
-    std::ostream &os = of;
-    for (int j = ny_ - 1; j >= 0; --j) {
-      for (size_t i = 0; i < nx_; ++i) {
-        os << sharedVisibilityField_->get(i, j) << " ";
-      }
-      os << "\n";
-    }
-    of.close();
     if (!sharedConfig_->silent) {
       std::cout << "Saved visibility field" << std::endl;
     }
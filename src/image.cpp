@@ -0,0 +1,89 @@
+#include "render/image.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#if defined(VBS_WITH_SFML)
+#include <SFML/Graphics.hpp>
+#endif
+
+namespace vbs {
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+Image occupancyImage(const OccupancyGrid &occupancy) {
+  const size_t nx = occupancy.nx();
+  const size_t ny = occupancy.ny();
+  Image image;
+  image.create(nx, ny, Color::Black);
+  for (size_t j = ny - 1; j > 0; --j) {
+    for (size_t i = 0; i < nx; ++i) {
+      if (occupancy.get(i, j)) {
+        image.setPixel(i, ny - 1 - j, Color::White);
+      }
+    }
+  }
+  return image;
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+bool saveImage(const Image &image, const std::string &filename) {
+#if defined(VBS_WITH_SFML)
+  sf::Image encoded;
+  encoded.create(image.width(), image.height(), image.getPixelsPtr());
+  return encoded.saveToFile(filename);
+#else
+  // Headless build, binary PPM needs no encoder
+  const std::string path =
+      std::filesystem::path(filename).replace_extension(".ppm").string();
+  std::ofstream of(path, std::ios::out | std::ios::trunc | std::ios::binary);
+  if (!of.is_open()) {
+    std::cerr << "Failed to open output file " << path << std::endl;
+    return false;
+  }
+  of << "P6\n" << image.width() << " " << image.height() << "\n255\n";
+  std::vector<char> row(image.width() * 3);
+  const uint8_t *pixels = image.getPixelsPtr();
+  for (size_t y = 0; y < image.height(); ++y) {
+    for (size_t x = 0; x < image.width(); ++x) {
+      const uint8_t *p = pixels + (y * image.width() + x) * 4;
+      row[3 * x] = static_cast<char>(p[0]);
+      row[3 * x + 1] = static_cast<char>(p[1]);
+      row[3 * x + 2] = static_cast<char>(p[2]);
+    }
+    of.write(row.data(), row.size());
+  }
+  return static_cast<bool>(of);
+#endif
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+bool loadImage(const std::string &filename, Image &image) {
+#if defined(VBS_WITH_SFML)
+  sf::Image decoded;
+  if (!decoded.loadFromFile(filename)) {
+    return false;
+  }
+  const auto size = decoded.getSize();
+  const uint8_t *pixels = decoded.getPixelsPtr();
+  image.create(size.x, size.y,
+               std::vector<uint8_t>(pixels, pixels + size_t(size.x) *
+                                                         size.y * 4));
+  return true;
+#else
+  (void)image;
+  std::cout << "Error: " << filename
+            << " needs SFML to be decoded, build with VBS_WITH_SFML or use a "
+               ".pgm, .pbm or .txt map"
+            << std::endl;
+  return false;
+#endif
+}
+
+} // namespace vbs
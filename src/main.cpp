@@ -1,9 +1,25 @@
 #include "environment/environment.h"
+#include "environment/memoryResource.h"
+#include "server/planningServer.h"
+#include "solver/precisionReport.h"
 #include "solver/visibilityBasedSolver.h"
 
 #include <iostream>
+#include <string>
+
+int main(int argc, char **argv) {
+  // --server answers queries from stdin, --server <path> from a Unix socket,
+  // see vbs::PlanningServer. Everything but the responses then goes to stderr.
+  const bool server = argc > 1 && std::string(argv[1]) == "--server";
+  if (server) {
+    // Replaces the buffers of the standard streams, so first
+    std::ios::sync_with_stdio(false);
+  }
+  std::streambuf *stdoutBuffer = std::cout.rdbuf();
+  if (server) {
+    std::cout.rdbuf(std::cerr.rdbuf());
+  }
 
-int main() {
   // Parse settings
   vbs::ConfigParser parser;
   if (!parser.parse("config/settings.config")) {
@@ -17,13 +33,33 @@ int main() {
     std::cout << "Config file parsed successfully \n" << std::endl;
   }
   auto config = parser.getConfig();
+  if (config.hugePages) {
+    vbs::setFieldResource(vbs::hugePageResource());
+  }
 
   // Initialize environment
   vbs::environment env = vbs::environment(config);
   // Initialize solver & solve
   vbs::visibilityBasedSolver solver = vbs::visibilityBasedSolver(env);
+  if (server) {
+    vbs::PlanningServer planningServer(env, solver);
+    bool served = true;
+    if (argc > 2) {
+      served = planningServer.serveSocket(argv[2]);
+    } else {
+      std::ostream responses(stdoutBuffer);
+      planningServer.serve(std::cin, responses);
+    }
+    std::cout.rdbuf(stdoutBuffer);
+    return served ? 0 : 1;
+  }
   solver.solve();
   // solver.standAloneVisibility();
   solver.benchmark();
   // solver.benchmarkSeries();
+  // solver.benchmarkTraversal();
+  // solver.benchmarkBatch();
+  // solver.benchmarkVisibilityBetween();
+  // solver.benchmarkRoadmap();
+  // vbs::reportPrecision(config, "images");
 }
@@ -0,0 +1,330 @@
+#include "environment/mapLoader.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace vbs {
+
+namespace {
+
+using word = OccupancyGrid::word;
+constexpr std::size_t wordBits = OccupancyGrid::wordBits;
+
+// Rows packed per task, enough to amortize claiming a task
+constexpr std::size_t rowsPerTask = 16;
+
+inline bool isBlank(const char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Fill the words of row y from isFree(x), cells past nx being free like the
+// padding of a grid resized as free
+template <typename IsFree>
+inline void packRow(OccupancyGrid &occupancy, const std::size_t y,
+                    IsFree &&isFree) {
+  word *row = occupancy.row(y);
+  const std::size_t nx = occupancy.nx();
+  for (std::size_t w = 0; w < occupancy.wordsPerRow(); ++w) {
+    const std::size_t x0 = w * wordBits;
+    const std::size_t n = std::min(wordBits, nx - x0);
+    word bits = n < wordBits ? ~word(0) << n : word(0);
+    for (std::size_t k = 0; k < n; ++k) {
+      bits |= word(isFree(x0 + k)) << k;
+    }
+    row[w] = bits;
+  }
+}
+
+// Run pack(y) for every row, rowsPerTask rows per task of the pool
+template <typename Pack>
+void forRows(const std::size_t ny, ThreadPool &pool, Pack &&pack) {
+  pool.run((ny + rowsPerTask - 1) / rowsPerTask, [&](std::size_t task) {
+    const std::size_t end = std::min(ny, (task + 1) * rowsPerTask);
+    for (std::size_t y = task * rowsPerTask; y < end; ++y) {
+      pack(y);
+    }
+  });
+}
+
+/*!
+ * @brief Read the next decimal field of a netpbm header, skipping the white
+ * space and the comments before it.
+ * @param [in,out] p Position in the header, moved past the field.
+ * @param [in] end End of the file.
+ * @param [out] value Field value.
+ * @return false if there is no field.
+ */
+bool headerField(const char *&p, const char *end, std::size_t &value) {
+  while (p < end && (std::isspace(static_cast<unsigned char>(*p)) ||
+                     *p == '#')) {
+    if (*p == '#') {
+      while (p < end && *p != '\n') {
+        ++p;
+      }
+    } else {
+      ++p;
+    }
+  }
+  const auto [next, ec] = std::from_chars(p, end, value);
+  if (ec != std::errc() || next == p) {
+    return false;
+  }
+  p = next;
+  return true;
+}
+
+// Bits of a byte in reverse order, PBM rows start at the most significant bit
+constexpr auto reversedBytes = [] {
+  std::array<std::uint8_t, 256> table{};
+  for (std::size_t b = 0; b < 256; ++b) {
+    for (std::size_t k = 0; k < 8; ++k) {
+      table[b] |= ((b >> k) & 1) << (7 - k);
+    }
+  }
+  return table;
+}();
+
+} // namespace
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+bool MappedFile::open(const std::string &filename) {
+  close();
+#if defined(_WIN32)
+  std::ifstream in(filename, std::ios::in | std::ios::binary | std::ios::ate);
+  if (!in.is_open()) {
+    return false;
+  }
+  size_ = static_cast<std::size_t>(in.tellg());
+  buffer_ = std::make_unique<char[]>(size_);
+  in.seekg(0);
+  in.read(buffer_.get(), size_);
+  if (!in) {
+    close();
+    return false;
+  }
+  data_ = buffer_.get();
+#else
+  const int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat status;
+  if (::fstat(fd, &status) != 0) {
+    ::close(fd);
+    return false;
+  }
+  size_ = static_cast<std::size_t>(status.st_size);
+  if (size_ > 0) {
+    void *address = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address == MAP_FAILED) {
+      ::close(fd);
+      size_ = 0;
+      return false;
+    }
+    // The loaders read the file once from start to end
+    ::madvise(address, size_, MADV_SEQUENTIAL);
+    data_ = static_cast<const char *>(address);
+    mapped_ = true;
+  }
+  // The mapping stays valid without the descriptor
+  ::close(fd);
+#endif
+  return true;
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+void MappedFile::close() {
+#if !defined(_WIN32)
+  if (mapped_) {
+    ::munmap(const_cast<char *>(data_), size_);
+  }
+#endif
+  buffer_.reset();
+  data_ = nullptr;
+  size_ = 0;
+  mapped_ = false;
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+void packPixels(const std::uint8_t *pixels, const std::size_t channels,
+                const std::uint8_t freeValue, OccupancyGrid &occupancy,
+                ThreadPool &pool) {
+  const std::size_t nx = occupancy.nx();
+  forRows(occupancy.ny(), pool, [&](const std::size_t y) {
+    const std::uint8_t *row = pixels + y * nx * channels;
+    packRow(occupancy, y, [&](const std::size_t x) {
+      return row[x * channels] == freeValue;
+    });
+  });
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+bool loadNetpbm(const std::string &filename, OccupancyGrid &occupancy,
+                ThreadPool &pool) {
+  MappedFile file;
+  if (!file.open(filename)) {
+    std::cerr << "Failed to open map " << filename << std::endl;
+    return false;
+  }
+  const char *p = file.data();
+  const char *end = p + file.size();
+  if (file.size() < 2 || p[0] != 'P' || (p[1] != '4' && p[1] != '5')) {
+    std::cerr << "Not a binary PBM or PGM map " << filename << std::endl;
+    return false;
+  }
+  const bool bitmap = p[1] == '4';
+  p += 2;
+  std::size_t nx = 0, ny = 0, maxValue = 1;
+  if (!headerField(p, end, nx) || !headerField(p, end, ny) ||
+      (!bitmap && !headerField(p, end, maxValue)) || nx == 0 || ny == 0 ||
+      maxValue == 0 || maxValue > 65535 || p == end) {
+    std::cerr << "Invalid netpbm header in " << filename << std::endl;
+    return false;
+  }
+  // A single white space character separates the header from the pixels
+  ++p;
+  const std::size_t bytesPerPixel = maxValue > 255 ? 2 : 1;
+  const std::size_t rowBytes = bitmap ? (nx + 7) / 8 : nx * bytesPerPixel;
+  if (static_cast<std::size_t>(end - p) / rowBytes < ny) {
+    std::cerr << "Map " << filename << " is truncated" << std::endl;
+    return false;
+  }
+  const std::uint8_t *pixels = reinterpret_cast<const std::uint8_t *>(p);
+
+  occupancy.resize(nx, ny, true);
+  if (bitmap) {
+    // Eight bytes of the file make a word of the grid, bits set in the file
+    // being occupied cells
+    forRows(ny, pool, [&](const std::size_t y) {
+      const std::uint8_t *in = pixels + y * rowBytes;
+      word *row = occupancy.row(y);
+      for (std::size_t w = 0; w < occupancy.wordsPerRow(); ++w) {
+        const std::size_t b0 = w * sizeof(word);
+        const std::size_t n = std::min(sizeof(word), rowBytes - b0);
+        word occupied = 0;
+        for (std::size_t b = 0; b < n; ++b) {
+          occupied |= word(reversedBytes[in[b0 + b]]) << (8 * b);
+        }
+        const std::size_t cells = std::min(wordBits, nx - w * wordBits);
+        row[w] = ~occupied | (cells < wordBits ? ~word(0) << cells : 0);
+      }
+    });
+  } else if (bytesPerPixel == 1) {
+    packPixels(pixels, 1, static_cast<std::uint8_t>(maxValue), occupancy,
+               pool);
+  } else {
+    // Most significant byte first
+    forRows(ny, pool, [&](const std::size_t y) {
+      const std::uint8_t *row = pixels + y * rowBytes;
+      packRow(occupancy, y, [&](const std::size_t x) {
+        return (std::size_t(row[2 * x]) << 8 | row[2 * x + 1]) == maxValue;
+      });
+    });
+  }
+  return true;
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+bool loadTextMap(const std::string &filename, OccupancyGrid &occupancy,
+                 ThreadPool &pool) {
+  MappedFile file;
+  if (!file.open(filename)) {
+    std::cerr << "Failed to open map " << filename << std::endl;
+    return false;
+  }
+  // Non-blank lines as [begin, end)
+  std::vector<std::pair<const char *, const char *>> lines;
+  const char *end = file.data() + file.size();
+  for (const char *p = file.data(); p < end;) {
+    const char *eol = static_cast<const char *>(std::memchr(p, '\n', end - p));
+    if (eol == nullptr) {
+      eol = end;
+    }
+    if (std::find_if_not(p, eol, isBlank) != eol) {
+      lines.emplace_back(p, eol);
+    }
+    p = eol + 1;
+  }
+  if (lines.empty()) {
+    std::cerr << "Map " << filename << " is empty" << std::endl;
+    return false;
+  }
+
+  // The first line sets the number of values per line
+  const std::size_t nx = lines.size();
+  std::size_t ny = 0;
+  for (const char *p = lines[0].first; p < lines[0].second;) {
+    p = std::find_if_not(p, lines[0].second, isBlank);
+    if (p < lines[0].second) {
+      ++ny;
+      p = std::find_if(p, lines[0].second, isBlank);
+    }
+  }
+  occupancy.resize(nx, ny, true);
+
+  // Block k of 64 lines only writes word k of each row of the grid
+  const std::size_t blocks = (nx + wordBits - 1) / wordBits;
+  constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+  std::vector<std::size_t> firstError(blocks, none);
+  pool.run(blocks, [&](const std::size_t k) {
+    const std::size_t xEnd = std::min(nx, (k + 1) * wordBits);
+    for (std::size_t x = k * wordBits; x < xEnd; ++x) {
+      const char *p = lines[x].first;
+      const char *lineEnd = lines[x].second;
+      const word bit = word(1) << (x % wordBits);
+      for (std::size_t y = 0; y < ny; ++y) {
+        p = std::find_if_not(p, lineEnd, isBlank);
+        float value = 0;
+        const auto [next, ec] = std::from_chars(p, lineEnd, value);
+        if (ec != std::errc() || next == p) {
+          firstError[k] = x;
+          return;
+        }
+        if (value == 0) {
+          occupancy.row(y)[k] &= ~bit;
+        }
+        p = next;
+      }
+      if (std::find_if_not(p, lineEnd, isBlank) != lineEnd) {
+        firstError[k] = x;
+        return;
+      }
+    }
+  });
+  const auto error = std::min_element(firstError.begin(), firstError.end());
+  if (*error != none) {
+    std::cerr << "Invalid map " << filename << ": non-blank line "
+              << *error + 1 << " does not hold " << ny << " values"
+              << std::endl;
+    return false;
+  }
+  return true;
+}
+
+} // namespace vbs
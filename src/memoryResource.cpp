@@ -0,0 +1,109 @@
+#include "environment/memoryResource.h"
+
+#include <atomic>
+#include <cstdint>
+#include <new>
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#endif
+
+namespace vbs {
+
+namespace {
+
+std::atomic<std::pmr::memory_resource *> currentFieldResource{
+    std::pmr::new_delete_resource()};
+
+inline std::size_t roundUp(const std::size_t bytes, const std::size_t to) {
+  return (bytes + to - 1) / to * to;
+}
+
+// Blocks that do not get huge pages
+inline bool isSmall(const std::size_t bytes, const std::size_t alignment) {
+  return bytes < HugePageResource::hugePageSize ||
+         alignment > HugePageResource::hugePageSize;
+}
+
+} // namespace
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+void *HugePageResource::do_allocate(const std::size_t bytes,
+                                    const std::size_t alignment) {
+#if defined(_WIN32)
+  return upstream_->allocate(bytes, alignment);
+#else
+  if (isSmall(bytes, alignment)) {
+    return upstream_->allocate(bytes, alignment);
+  }
+  // Map one huge page more than needed and trim the block to a boundary, as
+  // a huge page can only back an aligned 2 MiB of addresses
+  const std::size_t size = roundUp(bytes, hugePageSize);
+  void *mapped = ::mmap(nullptr, size + hugePageSize, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapped == MAP_FAILED) {
+    throw std::bad_alloc();
+  }
+  char *begin = static_cast<char *>(mapped);
+  char *end = begin + size + hugePageSize;
+  char *aligned = begin + (roundUp(reinterpret_cast<std::uintptr_t>(begin),
+                                   hugePageSize) -
+                           reinterpret_cast<std::uintptr_t>(begin));
+  if (aligned > begin) {
+    ::munmap(begin, aligned - begin);
+  }
+  if (end > aligned + size) {
+    ::munmap(aligned + size, end - (aligned + size));
+  }
+#if defined(MADV_HUGEPAGE)
+  ::madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+  return aligned;
+#endif
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+void HugePageResource::do_deallocate(void *p, const std::size_t bytes,
+                                     const std::size_t alignment) {
+#if defined(_WIN32)
+  upstream_->deallocate(p, bytes, alignment);
+#else
+  if (isSmall(bytes, alignment)) {
+    upstream_->deallocate(p, bytes, alignment);
+    return;
+  }
+  ::munmap(p, roundUp(bytes, hugePageSize));
+#endif
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+std::pmr::memory_resource *hugePageResource() {
+  // Never destroyed, fields may outlive the statics of this file
+  static HugePageResource *resource = new HugePageResource();
+  return resource;
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+std::pmr::memory_resource *fieldResource() {
+  return currentFieldResource.load(std::memory_order_acquire);
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+std::pmr::memory_resource *
+setFieldResource(std::pmr::memory_resource *resource) {
+  return currentFieldResource.exchange(
+      resource ? resource : std::pmr::new_delete_resource(),
+      std::memory_order_acq_rel);
+}
+
+} // namespace vbs
@@ -210,6 +210,65 @@ bool ConfigParser::parse(const std::string &filename) {
         std::cerr << "It must be a positive double between 0 and 1\n";
         return false;
       }
+    } else if (key == "threads") {
+      try {
+        if (std::stoi(value) < 0) {
+          std::cerr << "Invalid value for " << key << ": " << value << '\n';
+          std::cerr << "It must be a positive integer\n";
+          return false;
+        }
+        config_.threads = std::stoi(value);
+      } catch (...) {
+        std::cerr << "Invalid value for " << key << ": " << value << '\n';
+        std::cerr << "It must be a positive integer\n";
+        return false;
+      }
+    } else if (key == "cornerPivots") {
+      if (value == "0" || value == "false") {
+        config_.cornerPivots = false;
+      } else if (value == "1" || value == "true") {
+        config_.cornerPivots = true;
+      } else {
+        std::cerr << "Invalid value for " << key << ": " << value << '\n';
+        std::cerr << "It must be a boolean\n";
+        return false;
+      }
+    } else if (key == "hugePages") {
+      if (value == "0" || value == "false") {
+        config_.hugePages = false;
+      } else if (value == "1" || value == "true") {
+        config_.hugePages = true;
+      } else {
+        std::cerr << "Invalid value for " << key << ": " << value << '\n';
+        std::cerr << "It must be a boolean\n";
+        return false;
+      }
+    } else if (key == "visibilityRadius") {
+      try {
+        config_.visibilityRadius = std::stod(value);
+        if (config_.visibilityRadius < 0.0) {
+          std::cerr << "Invalid value for " << key << ": " << value << '\n';
+          std::cerr << "It must be a positive double\n";
+          return false;
+        }
+      } catch (...) {
+        std::cerr << "Invalid value for " << key << ": " << value << '\n';
+        std::cerr << "It must be a positive double\n";
+        return false;
+      }
+    } else if (key == "visibilityDecay") {
+      try {
+        config_.visibilityDecay = std::stod(value);
+        if (config_.visibilityDecay < 0.0) {
+          std::cerr << "Invalid value for " << key << ": " << value << '\n';
+          std::cerr << "It must be a positive double\n";
+          return false;
+        }
+      } catch (...) {
+        std::cerr << "Invalid value for " << key << ": " << value << '\n';
+        std::cerr << "It must be a positive double\n";
+        return false;
+      }
     } else if (key == "timer") {
       if (value == "0" || value == "false") {
         config_.timer = false;
@@ -270,6 +329,32 @@ bool ConfigParser::parse(const std::string &filename) {
         std::cerr << "It must be a boolean\n";
         return false;
       }
+    } else if (key == "outputFormat") {
+      try {
+        config_.outputFormat = std::stoi(value);
+        if (config_.outputFormat != 0 && config_.outputFormat != 1) {
+          std::cerr << "Invalid value for " << key << ": " << value
+                    << ", using default value 0\n";
+          config_.outputFormat = 0;
+        }
+      } catch (...) {
+        std::cerr << "Invalid value for " << key << ": " << value << '\n';
+        std::cerr << "It must be an integer 0 or 1 \n";
+        return false;
+      }
+    } else if (key == "writerQueue") {
+      try {
+        if (std::stoi(value) < 0) {
+          std::cerr << "Invalid value for " << key << ": " << value << '\n';
+          std::cerr << "It must be a positive integer\n";
+          return false;
+        }
+        config_.writerQueue = std::stoi(value);
+      } catch (...) {
+        std::cerr << "Invalid value for " << key << ": " << value << '\n';
+        std::cerr << "It must be a positive integer\n";
+        return false;
+      }
     } else if (key == "silent") {
       if (value == "0" || value == "false") {
         config_.silent = false;
@@ -323,7 +408,12 @@ bool ConfigParser::parse(const std::string &filename) {
               << "Maximum iterations: " << config_.max_iter << "\n"
               << "Solver visibility threshold: " << config_.visibilityThreshold
               << "\n"
-              << "Light strength: " << config_.lightStrength << std::endl;
+              << "Light strength: " << config_.lightStrength << "\n"
+              << "Threads: " << config_.threads << "\n"
+              << "Corner pivots: " << config_.cornerPivots << "\n"
+              << "Visibility radius: " << config_.visibilityRadius << "\n"
+              << "Visibility decay: " << config_.visibilityDecay << "\n"
+              << "Huge pages: " << config_.hugePages << std::endl;
     std::cout << "#################### Output settings "
                  "###################### \n"
               << "timer: " << config_.timer << "\n"
@@ -332,7 +422,9 @@ bool ConfigParser::parse(const std::string &filename) {
               << "saveVisibilityField: " << config_.saveGlobalVisibility << "\n"
               << "saveLocalVisibility: " << config_.saveLocalVisibility << "\n"
               << "saveVisibilityMapEnv: " << config_.saveVisibilityField
-              << std::endl;
+              << "\n"
+              << "outputFormat: " << config_.outputFormat << "\n"
+              << "writerQueue: " << config_.writerQueue << std::endl;
   }
   return true;
 }
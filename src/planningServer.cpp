@@ -0,0 +1,376 @@
+#include "server/planningServer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <random>
+
+#if !defined(_WIN32)
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace vbs {
+
+namespace {
+
+// Bytes read from a client at a time
+constexpr std::size_t chunkSize = 1 << 16;
+
+using steadyClock = std::chrono::steady_clock;
+
+inline double elapsedUs(const steadyClock::time_point start) {
+  return std::chrono::duration<double, std::micro>(steadyClock::now() - start)
+      .count();
+}
+
+void appendError(std::string &response, const std::string_view error) {
+  response += "\"ok\":false,\"error\":";
+  appendJson(response, error);
+}
+
+} // namespace
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+PlanningServer::PlanningServer(environment &env,
+                               visibilityBasedSolver<> &solver)
+    : solver_(solver), occupancy_(env.getVisibilityField()),
+      flip_(env.getConfig()->mode == 2) {}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+void PlanningServer::serve(std::istream &in, std::ostream &out) {
+  std::string line;
+  std::string response;
+  while (!stop_ && std::getline(in, line)) {
+    if (line.find_first_not_of(" \t\r") == std::string::npos) {
+      continue;
+    }
+    response.clear();
+    handle(line, response);
+    response += '\n';
+    out.write(response.data(), response.size());
+    // Pipelined queries are answered in one write
+    if (in.rdbuf()->in_avail() <= 0) {
+      out.flush();
+    }
+  }
+  out.flush();
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+void PlanningServer::handle(const std::string_view query,
+                            std::string &response) {
+  response += '{';
+  const bool parsed = JsonValue::parse(query, query_) &&
+                      query_.kind == JsonValue::Kind::object;
+  if (parsed) {
+    if (const JsonValue *id = query_.find("id")) {
+      response += "\"id\":";
+      appendJson(response, *id);
+      response += ',';
+    }
+  }
+  const JsonValue *op = parsed ? query_.find("op") : nullptr;
+  if (!parsed) {
+    appendError(response, "query is not a JSON object");
+  } else if (op == nullptr || op->kind != JsonValue::Kind::string) {
+    appendError(response, "missing op");
+  } else if (op->string == "solve") {
+    solve(query_, response);
+  } else if (op->string == "visibility") {
+    visibility(query_, response);
+  } else if (op->string == "benchmark") {
+    benchmark(query_, response);
+  } else if (op->string == "quit") {
+    stop_ = true;
+    response += "\"ok\":true";
+  } else {
+    appendError(response, "unknown op " + op->string);
+  }
+  response += '}';
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+bool PlanningServer::readCell(const JsonValue *value, point &cell) const {
+  if (value == nullptr || value->kind != JsonValue::Kind::array ||
+      value->array.size() != 2 || !value->array[0].isNumber() ||
+      !value->array[1].isNumber()) {
+    return false;
+  }
+  const double x = value->array[0].number;
+  const double y = value->array[1].number;
+  const double nx = static_cast<double>(occupancy_->nx());
+  const double ny = static_cast<double>(occupancy_->ny());
+  if (!(x >= 0 && x < nx && y >= 0 && y < ny)) {
+    return false;
+  }
+  cell = {static_cast<int>(x), static_cast<int>(y)};
+  if (flip_) {
+    cell.second = static_cast<int>(occupancy_->ny()) - 1 - cell.second;
+  }
+  return true;
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+void PlanningServer::appendCell(std::string &out, const point &cell) const {
+  out += '[';
+  appendJson(out, static_cast<double>(cell.first));
+  out += ',';
+  appendJson(out, static_cast<double>(
+                      flip_ ? static_cast<int>(occupancy_->ny()) - 1 -
+                                  cell.second
+                            : cell.second));
+  out += ']';
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+void PlanningServer::solve(const JsonValue &query, std::string &response) {
+  point start, goal;
+  if (!readCell(query.find("start"), start) ||
+      !readCell(query.find("goal"), goal)) {
+    appendError(response, "start and goal must be [x, y] in the grid");
+    return;
+  }
+  if (!occupancy_->get(start.first, start.second) ||
+      !occupancy_->get(goal.first, goal.second)) {
+    appendError(response, "start or goal is occupied");
+    return;
+  }
+  const auto time_start = steadyClock::now();
+  const double length = solver_.solve(start, goal, path_);
+  const double us = elapsedUs(time_start);
+  response += "\"ok\":true,\"length\":";
+  appendJson(response, length);
+  response += ",\"path\":[";
+  for (size_t i = 0; i < path_.size(); ++i) {
+    if (i > 0) {
+      response += ',';
+    }
+    appendCell(response, path_[i]);
+  }
+  response += "],\"us\":";
+  appendJson(response, us);
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+void PlanningServer::visibility(const JsonValue &query,
+                                std::string &response) {
+  point source;
+  if (!readCell(query.find("source"), source)) {
+    appendError(response, "source must be [x, y] in the grid");
+    return;
+  }
+  const JsonValue *targets = query.find("targets");
+  if (targets == nullptr || targets->kind != JsonValue::Kind::array) {
+    appendError(response, "targets must be [[x, y], ...]");
+    return;
+  }
+  // Checked before answering, so that an error leaves no partial values
+  std::vector<point> cells(targets->array.size());
+  for (size_t i = 0; i < cells.size(); ++i) {
+    if (!readCell(&targets->array[i], cells[i])) {
+      appendError(response, "targets must be [x, y] in the grid");
+      return;
+    }
+  }
+  response += "\"ok\":true,\"values\":[";
+  for (size_t i = 0; i < cells.size(); ++i) {
+    if (i > 0) {
+      response += ',';
+    }
+    appendJson(response, solver_.visibilityBetween(source, cells[i]));
+  }
+  response += ']';
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+void PlanningServer::benchmark(const JsonValue &query,
+                               std::string &response) {
+  const JsonValue *queries = query.find("queries");
+  const JsonValue *seed = query.find("seed");
+  const size_t nbQueries =
+      queries && queries->isNumber() && queries->number >= 1
+          ? static_cast<size_t>(queries->number)
+          : 100;
+  std::mt19937 generator(
+      seed && seed->isNumber() ? static_cast<unsigned>(seed->number) : 1);
+  std::uniform_int_distribution<size_t> randomX(0, occupancy_->nx() - 1);
+  std::uniform_int_distribution<size_t> randomY(0, occupancy_->ny() - 1);
+  // Draws are bounded, so a map with few free cells cannot hang the server
+  size_t draws = 0;
+  const size_t maxDraws = 1000 * nbQueries;
+  auto randomFreeCell = [&](point &cell) {
+    while (draws++ < maxDraws) {
+      const size_t x = randomX(generator);
+      const size_t y = randomY(generator);
+      if (occupancy_->get(x, y)) {
+        cell = {static_cast<int>(x), static_cast<int>(y)};
+        return true;
+      }
+    }
+    return false;
+  };
+
+  size_t found = 0;
+  double total = 0;
+  double fastest = std::numeric_limits<double>::infinity();
+  double slowest = 0;
+  for (size_t i = 0; i < nbQueries; ++i) {
+    point start, goal;
+    if (!randomFreeCell(start) || !randomFreeCell(goal)) {
+      appendError(response, "too few free cells to draw queries from");
+      return;
+    }
+    const auto time_start = steadyClock::now();
+    if (solver_.solve(start, goal, path_) <
+        std::numeric_limits<double>::infinity()) {
+      ++found;
+    }
+    const double us = elapsedUs(time_start);
+    total += us;
+    fastest = std::min(fastest, us);
+    slowest = std::max(slowest, us);
+  }
+  response += "\"ok\":true,\"queries\":";
+  appendJson(response, static_cast<double>(nbQueries));
+  response += ",\"found\":";
+  appendJson(response, static_cast<double>(found));
+  response += ",\"meanUs\":";
+  appendJson(response, total / nbQueries);
+  response += ",\"minUs\":";
+  appendJson(response, fastest);
+  response += ",\"maxUs\":";
+  appendJson(response, slowest);
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+bool PlanningServer::serveSocket(const std::string &path) {
+#if defined(_WIN32)
+  std::cerr << "Unix sockets are not available on this platform, serve "
+               "stdin instead"
+            << std::endl;
+  return false;
+#else
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+    std::cerr << "Invalid socket path " << path << std::endl;
+    return false;
+  }
+  std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+  // Only a socket left over by a previous server is replaced
+  struct stat status;
+  if (::lstat(path.c_str(), &status) == 0) {
+    if (!S_ISSOCK(status.st_mode)) {
+      std::cerr << path << " exists and is not a socket" << std::endl;
+      return false;
+    }
+    ::unlink(path.c_str());
+  }
+  const int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0) {
+    std::cerr << "Failed to create socket" << std::endl;
+    return false;
+  }
+  if (::bind(listener, reinterpret_cast<const sockaddr *>(&address),
+             sizeof(address)) != 0 ||
+      ::listen(listener, 16) != 0) {
+    std::cerr << "Failed to listen on " << path << std::endl;
+    ::close(listener);
+    return false;
+  }
+  std::cerr << "Serving queries on " << path << std::endl;
+  while (!stop_) {
+    const int client = ::accept(listener, nullptr, nullptr);
+    if (client < 0) {
+      continue;
+    }
+    serveConnection(client);
+    ::close(client);
+  }
+  ::close(listener);
+  ::unlink(path.c_str());
+  return true;
+#endif
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+void PlanningServer::serveConnection(const int client) {
+#if !defined(_WIN32)
+#if defined(MSG_NOSIGNAL)
+  // A client leaving early must not kill the server with SIGPIPE
+  const int flags = MSG_NOSIGNAL;
+#else
+  const int flags = 0;
+#if defined(SO_NOSIGPIPE)
+  const int on = 1;
+  ::setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+#endif
+  std::string pending;
+  std::string responses;
+  std::vector<char> chunk(chunkSize);
+  bool open = true;
+  while (open && !stop_) {
+    const ssize_t received = ::recv(client, chunk.data(), chunk.size(), 0);
+    if (received <= 0) {
+      // The last query may lack its newline
+      open = false;
+      pending += '\n';
+    } else {
+      pending.append(chunk.data(), received);
+    }
+    // Answer every complete line received so far, then send the answers
+    // together
+    size_t begin = 0;
+    responses.clear();
+    for (size_t end = pending.find('\n'); end != std::string::npos && !stop_;
+         end = pending.find('\n', begin)) {
+      const std::string_view line(pending.data() + begin, end - begin);
+      begin = end + 1;
+      if (line.find_first_not_of(" \t\r") == std::string_view::npos) {
+        continue;
+      }
+      handle(line, responses);
+      responses += '\n';
+    }
+    pending.erase(0, begin);
+    for (size_t sent = 0; sent < responses.size();) {
+      const ssize_t n = ::send(client, responses.data() + sent,
+                               responses.size() - sent, flags);
+      if (n <= 0) {
+        return;
+      }
+      sent += n;
+    }
+  }
+#else
+  (void)client;
+#endif
+}
+
+} // namespace vbs
@@ -0,0 +1,196 @@
+#include "solver/precisionReport.h"
+#include "environment/environment.h"
+#include "solver/visibilityBasedSolver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+namespace vbs {
+
+namespace {
+
+// Sweeps timed per precision, the fastest one is kept
+constexpr int repetitions = 5;
+
+// Visibility of one precision widened to double, and its best sweep time
+struct precisionRun {
+  std::vector<double> visibility;
+  double time = 0;
+};
+
+// Error of one precision against double, accumulated over images
+struct precisionError {
+  double maxError = 0;
+  double sumError = 0;
+  size_t flips = 0;
+  size_t cells = 0;
+  double time = 0;
+  double referenceTime = 0;
+};
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+template <typename T>
+precisionRun runPrecision(environment &env, const point &source) {
+  using traits = valueTraits<T>;
+  visibilityBasedSolver<T> solver(env);
+  precisionRun run;
+  run.time = std::numeric_limits<double>::max();
+  for (int r = 0; r < repetitions; ++r) {
+    auto time_start = std::chrono::high_resolution_clock::now();
+    solver.computeVisibility(source);
+    auto time_stop = std::chrono::high_resolution_clock::now();
+    run.time = std::min<double>(
+        run.time, std::chrono::duration_cast<std::chrono::microseconds>(
+                      time_stop - time_start)
+                      .count());
+  }
+  const Field<T> &visibility = solver.getVisibility();
+  run.visibility.resize(visibility.size());
+  for (size_t k = 0; k < visibility.size(); ++k) {
+    run.visibility[k] = traits::toDouble(visibility.data()[k]);
+  }
+  return run;
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+void compareRuns(const char *name, const precisionRun &run,
+                 const precisionRun &reference, const OccupancyGrid &occupancy,
+                 const double threshold, precisionError &total) {
+  double maxError = 0;
+  double sumError = 0;
+  size_t flips = 0;
+  size_t cells = 0;
+  for (size_t k = 0; k < occupancy.size(); ++k) {
+    if (!occupancy.get(k % occupancy.nx(), k / occupancy.nx())) {
+      continue;
+    }
+    const double v = run.visibility[k];
+    const double ref = reference.visibility[k];
+    maxError = std::max(maxError, std::abs(v - ref));
+    sumError += std::abs(v - ref);
+    if ((v >= threshold) != (ref >= threshold)) {
+      ++flips;
+    }
+    ++cells;
+  }
+  std::cout << "  " << std::setw(8) << std::left << name << std::right
+            << run.time << "us (" << reference.time / run.time
+            << "x), max error " << maxError << ", mean error "
+            << sumError / std::max<size_t>(cells, 1) << ", threshold flips "
+            << 100.0 * flips / std::max<size_t>(cells, 1) << "%" << std::endl;
+
+  total.maxError = std::max(total.maxError, maxError);
+  total.sumError += sumError;
+  total.flips += flips;
+  total.cells += cells;
+  total.time += run.time;
+  total.referenceTime += reference.time;
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+bool findSource(const OccupancyGrid &occupancy, point &source) {
+  const size_t size = occupancy.size();
+  size_t start = 0;
+  if (source.first >= 0 && source.second >= 0 &&
+      static_cast<size_t>(source.first) < occupancy.nx() &&
+      static_cast<size_t>(source.second) < occupancy.ny()) {
+    start = source.first + source.second * occupancy.nx();
+  }
+  for (size_t n = 0; n < size; ++n) {
+    const size_t k = (start + n) % size;
+    if (occupancy.get(k % occupancy.nx(), k / occupancy.nx())) {
+      source = {static_cast<int>(k % occupancy.nx()),
+                static_cast<int>(k / occupancy.nx())};
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+void reportPrecision(const Config &config, const std::string &directory) {
+  namespace fs = std::filesystem;
+  if (!fs::is_directory(directory)) {
+    std::cerr << "Failed to open image directory " << directory << std::endl;
+    return;
+  }
+  std::vector<fs::path> images;
+  for (const auto &entry : fs::directory_iterator(directory)) {
+    // Netpbm maps are read without SFML
+    const auto extension = entry.path().extension();
+    if (extension == ".png" || extension == ".pgm" || extension == ".pbm") {
+      images.push_back(entry.path());
+    }
+  }
+  std::sort(images.begin(), images.end());
+
+  std::cout << "############################## Precision report "
+               "##########################"
+            << std::endl;
+  precisionError floatTotal, fixedTotal;
+  for (const auto &image : images) {
+    Config imageConfig = config;
+    imageConfig.mode = 2;
+    imageConfig.imagePath = image.string();
+    imageConfig.saveResults = false;
+    imageConfig.silent = true;
+    environment env(imageConfig);
+    const auto &occupancy = env.getVisibilityField();
+    if (!occupancy) {
+      std::cout << "Skipping " << image.filename().string() << std::endl;
+      continue;
+    }
+
+    // Images are flipped vertically, as in solve()
+    point source = config.start;
+    source.second = occupancy->ny() - 1 - source.second;
+    if (!findSource(*occupancy, source)) {
+      std::cout << "Skipping " << image.filename().string()
+                << ", no free cell" << std::endl;
+      continue;
+    }
+
+    const precisionRun reference = runPrecision<double>(env, source);
+    std::cout << image.filename().string() << " " << occupancy->nx() << "x"
+              << occupancy->ny() << ", source " << source.first << ", "
+              << source.second << "\n"
+              << "  " << std::setw(8) << std::left << "double" << std::right
+              << reference.time << "us" << std::endl;
+    compareRuns("float", runPrecision<float>(env, source), reference,
+                *occupancy, config.visibilityThreshold, floatTotal);
+    compareRuns("fixed16", runPrecision<fixed16>(env, source), reference,
+                *occupancy, config.visibilityThreshold, fixedTotal);
+  }
+
+  std::cout << "All images, threshold " << config.visibilityThreshold << ":"
+            << std::endl;
+  for (const auto &[name, total] :
+       {std::pair<const char *, const precisionError &>{"float", floatTotal},
+        {"fixed16", fixedTotal}}) {
+    std::cout << "  " << std::setw(8) << std::left << name << std::right
+              << "speedup " << total.referenceTime / std::max(total.time, 1.0)
+              << "x, max error " << total.maxError << ", mean error "
+              << total.sumError / std::max<size_t>(total.cells, 1)
+              << ", threshold flips "
+              << 100.0 * total.flips / std::max<size_t>(total.cells, 1) << "%"
+              << std::endl;
+  }
+}
+
+} // namespace vbs
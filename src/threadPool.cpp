@@ -0,0 +1,107 @@
+#include "solver/threadPool.h"
+
+#include <algorithm>
+
+namespace vbs {
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+ThreadPool::ThreadPool(std::size_t threads) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  workers_.reserve(threads - 1);
+  for (std::size_t i = 1; i < threads; ++i) {
+    workers_.emplace_back(&ThreadPool::work, this);
+  }
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+void ThreadPool::runTask(std::size_t tasks, const TaskRef &task) {
+  if (tasks == 0) {
+    return;
+  }
+  if (workers_.empty()) {
+    for (std::size_t k = 0; k < tasks; ++k) {
+      task(k);
+    }
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task_ = &task;
+    tasks_ = tasks;
+    next_.store(0);
+    pending_.store(tasks);
+    ++generation_;
+  }
+  wake_.notify_all();
+  drain(task, tasks);
+
+  // Workers that joined this run must be out before task goes out of scope
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [this] { return pending_.load() == 0 && active_ == 0; });
+  task_ = nullptr;
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+void ThreadPool::drain(const TaskRef &task, std::size_t tasks) {
+  for (std::size_t k = next_++; k < tasks; k = next_++) {
+    task(k);
+    if (--pending_ == 0) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      done_.notify_all();
+    }
+  }
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+void ThreadPool::work() {
+  std::size_t seen = 0;
+  while (true) {
+    const TaskRef *task;
+    std::size_t tasks;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait(lock, [&] {
+        return stop_ || (generation_ != seen && task_ != nullptr);
+      });
+      if (stop_) {
+        return;
+      }
+      seen = generation_;
+      task = task_;
+      tasks = tasks_;
+      ++active_;
+    }
+    drain(*task, tasks);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      --active_;
+    }
+    done_.notify_all();
+  }
+}
+
+} // namespace vbs
@@ -0,0 +1,371 @@
+#include "api/vbs.h"
+
+#include "environment/environment.h"
+#include "solver/visibilityBasedSolver.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <new>
+#include <vector>
+
+// Planner behind the C handle. The occupancy is shared with the environment
+// and the solver, which keep their buffers between calls.
+struct vbs_planner {
+  std::shared_ptr<vbs::OccupancyGrid> occupancy;
+  std::unique_ptr<vbs::environment> env;
+  std::unique_ptr<vbs::visibilityBasedSolver<double>> solver;
+  // Path of the last solve, kept for its storage
+  std::vector<vbs::point> path;
+};
+
+namespace {
+
+// Nothing is printed, saved or written in the background
+vbs::Config configOf(const vbs_options *options) {
+  vbs_options defaults;
+  if (options == nullptr) {
+    vbs_default_options(&defaults);
+    options = &defaults;
+  }
+  vbs::Config config;
+  config.visibilityThreshold = options->visibility_threshold;
+  config.max_iter = options->max_iterations;
+  config.threads = options->threads;
+  config.cornerPivots = options->corner_pivots != 0;
+  config.visibilityRadius = options->visibility_radius;
+  config.visibilityDecay = options->visibility_decay;
+  config.timer = false;
+  config.saveResults = false;
+  config.silent = true;
+  config.writerQueue = 0;
+  return config;
+}
+
+bool validOptions(const vbs_options *options) {
+  return options == nullptr ||
+         (options->visibility_threshold > 0 &&
+          options->visibility_threshold < 1 &&
+          options->visibility_radius >= 0 && options->visibility_decay >= 0);
+}
+
+// Planner on an occupancy. Throws if it could not be created.
+vbs_planner *create(std::shared_ptr<vbs::OccupancyGrid> occupancy,
+                    const vbs_options *options) {
+  auto planner = std::make_unique<vbs_planner>();
+  vbs::Config config = configOf(options);
+  planner->occupancy = occupancy;
+  planner->env = std::make_unique<vbs::environment>(config, occupancy);
+  planner->solver =
+      std::make_unique<vbs::visibilityBasedSolver<double>>(*planner->env);
+  return planner.release();
+}
+
+// Status of a call, as exceptions must not cross the C interface: a failed
+// allocation is reported as such, anything else as an internal error
+template <typename Call> vbs_status guarded(Call &&call) noexcept {
+  try {
+    return call();
+  } catch (const std::bad_alloc &) {
+    return VBS_OUT_OF_MEMORY;
+  } catch (...) {
+    return VBS_INTERNAL_ERROR;
+  }
+}
+
+inline bool inGrid(const vbs_planner *planner, const int32_t x,
+                   const int32_t y) {
+  return x >= 0 && y >= 0 &&
+         static_cast<size_t>(x) < planner->occupancy->nx() &&
+         static_cast<size_t>(y) < planner->occupancy->ny();
+}
+
+inline bool isFree(const vbs_planner *planner, const int32_t x,
+                   const int32_t y) {
+  return inGrid(planner, x, y) && planner->occupancy->get(x, y);
+}
+
+// Copy a field of the solver out, row-major
+template <typename Out, typename In>
+void copyField(const vbs::Field<In> &field, Out *out) {
+  std::transform(field.data(), field.data() + field.nx() * field.ny(), out,
+                 [](const In value) { return static_cast<Out>(value); });
+}
+
+} // namespace
+
+extern "C" {
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+int vbs_api_version(void) { return 1; }
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+void vbs_default_options(vbs_options *options) {
+  if (options == nullptr) {
+    return;
+  }
+  // A Config holds strings, though short enough not to allocate
+  try {
+    const vbs::Config config;
+    options->visibility_threshold = config.visibilityThreshold;
+    options->max_iterations = config.max_iter;
+    options->threads = config.threads;
+    options->corner_pivots = config.cornerPivots ? 1 : 0;
+    options->visibility_radius = config.visibilityRadius;
+    options->visibility_decay = config.visibilityDecay;
+  } catch (...) {
+  }
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+const char *vbs_status_string(const vbs_status status) {
+  switch (status) {
+  case VBS_OK:
+    return "ok";
+  case VBS_INVALID_ARGUMENT:
+    return "invalid argument";
+  case VBS_NO_PATH:
+    return "no path found";
+  case VBS_BUFFER_TOO_SMALL:
+    return "buffer too small";
+  case VBS_OUT_OF_MEMORY:
+    return "out of memory";
+  case VBS_INTERNAL_ERROR:
+    return "internal error";
+  }
+  return "unknown status";
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+size_t vbs_words_per_row(const size_t nx) {
+  return vbs::OccupancyGrid::wordsPerRow(nx);
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+vbs_planner *vbs_create_view(uint64_t *words, const size_t nx,
+                             const size_t ny, const vbs_options *options) {
+  if (words == nullptr || nx == 0 || ny == 0 || !validOptions(options)) {
+    return nullptr;
+  }
+  try {
+    auto occupancy = std::make_shared<vbs::OccupancyGrid>();
+    occupancy->view(words, nx, ny);
+    return create(std::move(occupancy), options);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+vbs_planner *vbs_create(const uint8_t *cells, const size_t nx, const size_t ny,
+                        const size_t stride, const vbs_options *options) {
+  if (cells == nullptr || nx == 0 || ny == 0 || stride < nx ||
+      !validOptions(options)) {
+    return nullptr;
+  }
+  try {
+    auto occupancy = std::make_shared<vbs::OccupancyGrid>(nx, ny, true);
+    for (size_t y = 0; y < ny; ++y) {
+      const uint8_t *in = cells + y * stride;
+      uint64_t *row = occupancy->row(y);
+      for (size_t x = 0; x < nx; ++x) {
+        if (in[x] == 0) {
+          row[x / vbs::OccupancyGrid::wordBits] &=
+              ~(uint64_t(1) << (x % vbs::OccupancyGrid::wordBits));
+        }
+      }
+    }
+    return create(std::move(occupancy), options);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+void vbs_destroy(vbs_planner *planner) { delete planner; }
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+vbs_status vbs_size(const vbs_planner *planner, size_t *nx, size_t *ny) {
+  if (planner == nullptr || nx == nullptr || ny == nullptr) {
+    return VBS_INVALID_ARGUMENT;
+  }
+  return guarded([&] {
+    *nx = planner->occupancy->nx();
+    *ny = planner->occupancy->ny();
+    return VBS_OK;
+  });
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+vbs_status vbs_occupancy_changed(vbs_planner *planner) {
+  if (planner == nullptr) {
+    return VBS_INVALID_ARGUMENT;
+  }
+  return guarded([&] {
+    planner->env->occupancyChanged();
+    return VBS_OK;
+  });
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+vbs_status vbs_update_cells(vbs_planner *planner,
+                            const vbs_cell_update *updates,
+                            const size_t count) {
+  if (planner == nullptr || (updates == nullptr && count > 0)) {
+    return VBS_INVALID_ARGUMENT;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    if (!inGrid(planner, updates[i].x, updates[i].y)) {
+      return VBS_INVALID_ARGUMENT;
+    }
+  }
+  return guarded([&] {
+    std::vector<vbs::CellUpdate> cells(count);
+    for (size_t i = 0; i < count; ++i) {
+      cells[i] = {updates[i].x, updates[i].y, updates[i].free != 0};
+    }
+    planner->env->updateCells(cells);
+    return VBS_OK;
+  });
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+vbs_status vbs_solve(vbs_planner *planner, const int32_t start_x,
+                     const int32_t start_y, const int32_t goal_x,
+                     const int32_t goal_y, int32_t *path,
+                     const size_t capacity, size_t *path_size,
+                     double *length) {
+  if (planner == nullptr || (path == nullptr && capacity > 0) ||
+      !isFree(planner, start_x, start_y) || !isFree(planner, goal_x, goal_y)) {
+    return VBS_INVALID_ARGUMENT;
+  }
+  return guarded([&] {
+    const double distance = planner->solver->solve(
+        {start_x, start_y}, {goal_x, goal_y}, planner->path);
+    if (path_size != nullptr) {
+      *path_size = planner->path.size();
+    }
+    if (length != nullptr) {
+      *length = distance;
+    }
+    if (!std::isfinite(distance)) {
+      return VBS_NO_PATH;
+    }
+    if (planner->path.size() > capacity) {
+      return path == nullptr ? VBS_OK : VBS_BUFFER_TOO_SMALL;
+    }
+    for (size_t i = 0; i < planner->path.size(); ++i) {
+      path[2 * i] = planner->path[i].first;
+      path[2 * i + 1] = planner->path[i].second;
+    }
+    return VBS_OK;
+  });
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+vbs_status vbs_global_visibility(const vbs_planner *planner,
+                                 double *visibility) {
+  if (planner == nullptr || visibility == nullptr) {
+    return VBS_INVALID_ARGUMENT;
+  }
+  return guarded([&] {
+    copyField(planner->solver->getGlobalVisibility(), visibility);
+    return VBS_OK;
+  });
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+vbs_status vbs_came_from(const vbs_planner *planner, uint64_t *came_from) {
+  if (planner == nullptr || came_from == nullptr) {
+    return VBS_INVALID_ARGUMENT;
+  }
+  return guarded([&] {
+    copyField(planner->solver->getCameFrom(), came_from);
+    return VBS_OK;
+  });
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+vbs_status vbs_light_sources(const vbs_planner *planner, int32_t *sources,
+                             const size_t capacity, size_t *count) {
+  if (planner == nullptr || (sources == nullptr && capacity > 0)) {
+    return VBS_INVALID_ARGUMENT;
+  }
+  return guarded([&] {
+    const size_t n = planner->solver->getNbOfSources();
+    if (count != nullptr) {
+      *count = n;
+    }
+    if (n > capacity) {
+      return sources == nullptr ? VBS_OK : VBS_BUFFER_TOO_SMALL;
+    }
+    const vbs::point *lightSources = planner->solver->getLightSources();
+    for (size_t i = 0; i < n; ++i) {
+      sources[2 * i] = lightSources[i].first;
+      sources[2 * i + 1] = lightSources[i].second;
+    }
+    return VBS_OK;
+  });
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+vbs_status vbs_visibility(vbs_planner *planner, const int32_t x,
+                          const int32_t y, double *visibility) {
+  if (planner == nullptr || visibility == nullptr || !inGrid(planner, x, y)) {
+    return VBS_INVALID_ARGUMENT;
+  }
+  return guarded([&] {
+    planner->solver->computeVisibility({x, y});
+    copyField(planner->solver->getVisibility(), visibility);
+    return VBS_OK;
+  });
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+vbs_status vbs_visibility_between(vbs_planner *planner, const int32_t ax,
+                                  const int32_t ay, const int32_t bx,
+                                  const int32_t by, double *visibility) {
+  if (planner == nullptr || visibility == nullptr ||
+      !inGrid(planner, ax, ay) || !inGrid(planner, bx, by)) {
+    return VBS_INVALID_ARGUMENT;
+  }
+  return guarded([&] {
+    *visibility = planner->solver->visibilityBetween({ax, ay}, {bx, by});
+    return VBS_OK;
+  });
+}
+
+} // extern "C"
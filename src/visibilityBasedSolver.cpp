@@ -1,36 +1,31 @@
 #include "solver/visibilityBasedSolver.h"
+#include "render/image.h"
 
+#include <algorithm>
+#include <bit>
 #include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <random>
 
 namespace vbs {
 
 /*****************************************************************************/
 /*****************************************************************************/
 /*****************************************************************************/
-visibilityBasedSolver::visibilityBasedSolver(environment &env)
+template <typename T>
+visibilityBasedSolver<T>::visibilityBasedSolver(environment &env)
     : occupancyComplement_(env.getVisibilityField()),
-      sharedConfig_(env.getConfig()) {
+      sharedConfig_(env.getConfig()),
+      goalDistanceCache_(env.getGoalDistanceCache()),
+      cornerIndex_(env.getCornerIndex()) {
   nx_ = occupancyComplement_->nx();
   ny_ = occupancyComplement_->ny();
   visibilityThreshold_ = sharedConfig_->visibilityThreshold;
-
-  // Init environment image
-  uniqueLoadedImage_.reset(std::make_unique<sf::Image>().release());
-  uniqueLoadedImage_->create(nx_, ny_, sf::Color::Black);
-  sf::Color color;
-  color.a = 1;
-  for (size_t j = ny_ - 1; j > 0; --j) {
-    for (size_t i = 0; i < nx_; ++i) {
-      if (occupancyComplement_->get(i, j) < 1) {
-        uniqueLoadedImage_->setPixel(i, ny_ - 1 - j, color.Black);
-      } else {
-        uniqueLoadedImage_->setPixel(i, ny_ - 1 - j, color.White);
-      }
-    }
-  }
+  setRange(sharedConfig_->visibilityRadius, sharedConfig_->visibilityDecay);
+  pool_ = std::make_unique<ThreadPool>(sharedConfig_->threads);
+  writer_ = std::make_unique<AsyncWriter>(sharedConfig_->writerQueue);
 
   // Init maps
   reset();
@@ -39,22 +34,20 @@ visibilityBasedSolver::visibilityBasedSolver(environment &env)
 /*****************************************************************************/
 /*****************************************************************************/
 /*****************************************************************************/
-void visibilityBasedSolver::reset() {
+template <typename T>
+void visibilityBasedSolver<T>::reset() {
   visibility_global_.resize(nx_, ny_, 0.0);
   visibility_.resize(nx_, ny_, 0.0);
   visibilityRayCasting_.resize(nx_, ny_, 1.0);
   cameFrom_.resize(nx_, ny_, 1e15);
+  isLightSource_.resize(nx_, ny_, false);
 
-  lightSources_.reset(new point[nx_ * ny_]);
+  lightSources_.resize(sharedConfig_->max_iter + 2);
+  iterationTimings_.reserve(sharedConfig_->max_iter + 1);
   scale_ = sqrt(ny_ * ny_ + nx_ * nx_);
-  heap_.reset();
-
-  // Reserve heap_
-  std::vector<Node> container;
-  container.reserve(nx_ * ny_);
-  std::priority_queue<Node, std::vector<Node>, std::less<Node>> heap(
-      std::less<Node>(), std::move(container));
-  heap_ = std::make_unique<std::priority_queue<Node>>(heap);
+  pivotIndex_.reset(nx_, ny_);
+  swept_ = {0, 0, 0, 0};
+  folded_ = {0, 0, 0, 0};
 
   nb_of_sources_ = 0;
 }
@@ -62,18 +55,217 @@ void visibilityBasedSolver::reset() {
 /*****************************************************************************/
 /*****************************************************************************/
 /*****************************************************************************/
-void visibilityBasedSolver::resetQueue() {
-  std::vector<Node> container;
-  container.reserve(ny_ * nx_);
-  std::priority_queue<Node, std::vector<Node>, std::less<Node>> heap(
-      std::less<Node>(), std::move(container));
-  heap_ = std::make_unique<std::priority_queue<Node>>(heap);
+template <typename T>
+void visibilityBasedSolver<T>::setRange(const double radius,
+                                        const double decay) {
+  radius_ = radius;
+  decay_ = decay;
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+template <typename T>
+Window visibilityBasedSolver<T>::startSweep() {
+  const Window window = windowAround(ls_, nx_, ny_, windowRadius());
+  // A sweep of the whole grid writes every cell
+  startSweep(window, radius_ > 0);
+  return window;
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+template <typename T>
+void visibilityBasedSolver<T>::startSweep(const Window &window,
+                                          const bool partial) {
+  // Every cell of the window is written again, by the sweep or by the range
+  if (partial) {
+    clearSwept(window);
+    for (const size_t cell : frontier_) {
+      visibility_.data()[cell] = traits::fromDouble(0.0);
+    }
+    frontier_.clear();
+  }
+  sweepAxes(visibility_, *occupancyComplement_, ls_, lightStrength_, window);
+  swept_ = window;
+  sector_.reset();
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+template <typename T>
+void visibilityBasedSolver<T>::clearSwept(const Window &keep) {
+  const T dark = traits::fromDouble(0.0);
+  for (size_t y = swept_.yBegin; y < swept_.yEnd; ++y) {
+    T *row = &visibility_(0, y);
+    if (y < keep.yBegin || y >= keep.yEnd) {
+      std::fill(row + swept_.xBegin, row + swept_.xEnd, dark);
+      continue;
+    }
+    std::fill(row + swept_.xBegin,
+              row + std::max(swept_.xBegin, std::min(swept_.xEnd, keep.xBegin)),
+              dark);
+    std::fill(row + std::min(swept_.xEnd, std::max(swept_.xBegin, keep.xEnd)),
+              row + swept_.xEnd, dark);
+  }
+  swept_ = {0, 0, 0, 0};
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+template <typename T>
+void visibilityBasedSolver<T>::applyRange(Field<T> &field, const point &source,
+                                          const Window &window,
+                                          const Sector *sector) const {
+  const T dark = traits::fromDouble(0.0);
+  auto isLit = [&](const size_t x, const size_t y) {
+    return isInRange(x, y, source) &&
+           (!sector || sector->contains(static_cast<double>(x) - source.first,
+                                        static_cast<double>(y) -
+                                            source.second));
+  };
+  // Column of the window nearest to x
+  auto column = [&](const double x) {
+    return x <= window.xBegin ? window.xBegin
+           : x >= window.xEnd ? window.xEnd
+                              : static_cast<size_t>(x);
+  };
+  for (size_t y = window.yBegin; y < window.yEnd; ++y) {
+    // The lit cells of a row are a run [xBegin, xEnd). Its ends are found
+    // from the disc of the range and the edges of the sector, then settled
+    // cell by cell, and the cells either side of it are darkened.
+    const double dy = static_cast<double>(y) - source.second;
+    double lo = -std::numeric_limits<double>::infinity();
+    double hi = std::numeric_limits<double>::infinity();
+    if (radius_ > 0) {
+      const double half = std::sqrt(std::max(0.0, radius_ * radius_ - dy * dy));
+      lo = -half;
+      hi = half;
+    }
+    if (sector && sector->isConvex()) {
+      sector->narrow(dy, lo, hi);
+    }
+    size_t xBegin = column(source.first + std::floor(lo));
+    if (xBegin < window.xEnd && isLit(xBegin, y)) {
+      while (xBegin > window.xBegin && isLit(xBegin - 1, y)) {
+        --xBegin;
+      }
+    } else {
+      while (xBegin < window.xEnd && !isLit(xBegin, y)) {
+        ++xBegin;
+      }
+      // The bounds were off or the row is dark
+      if (xBegin == window.xEnd) {
+        xBegin = window.xBegin;
+        while (xBegin < window.xEnd && !isLit(xBegin, y)) {
+          ++xBegin;
+        }
+      }
+    }
+    size_t xEnd = xBegin;
+    if (xBegin < window.xEnd) {
+      xEnd = std::max(xBegin + 1, column(source.first + std::ceil(hi) + 1));
+      if (isLit(xEnd - 1, y)) {
+        while (xEnd < window.xEnd && isLit(xEnd, y)) {
+          ++xEnd;
+        }
+      } else {
+        while (!isLit(xEnd - 1, y)) {
+          --xEnd;
+        }
+      }
+    }
+    std::fill(&field(window.xBegin, y), &field(0, y) + xBegin, dark);
+    std::fill(&field(0, y) + xEnd, &field(0, y) + window.xEnd, dark);
+    // Unless the sector is wider than a half turn, then the cells outside of
+    // it can also be a run within the row, which holds one of the cells
+    // either side of the crossing of the opposite ray
+    double dx;
+    if (sector && !sector->isConvex() &&
+        sector->opposite(static_cast<double>(y) - source.second, dx)) {
+      const double x = source.first + dx;
+      for (const double c : {std::floor(x), std::ceil(x)}) {
+        if (c < xBegin || c >= xEnd || isLit(static_cast<size_t>(c), y)) {
+          continue;
+        }
+        size_t b = static_cast<size_t>(c);
+        size_t e = b + 1;
+        while (b > xBegin && !isLit(b - 1, y)) {
+          --b;
+        }
+        while (e < xEnd && !isLit(e, y)) {
+          ++e;
+        }
+        std::fill(&field(b, y), &field(0, y) + e, dark);
+        break;
+      }
+    }
+    if (decay_ > 0) {
+      for (size_t x = xBegin; x < xEnd; ++x) {
+        field(x, y) = ranged(x, y, source, field(x, y));
+      }
+    }
+  }
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+template <typename T>
+void visibilityBasedSolver<T>::heuristics(const size_t y, const size_t x0,
+                                          const size_t x1, double *h) {
+  using Pack = simd::nativePack<double>;
+  constexpr size_t n = PivotIndex::tileSize;
+  static_assert(n % Pack::width == 0 && n <= 32);
+
+  // Gather the terms of the cells so the rest runs a pack at a time, over the
+  // packs covering [x0, x1). Cells past x1 and cells that are not candidates
+  // have no parent and are zeroed.
+  alignas(64) double g[n], goal[n], dx[n], dy[n];
+  const double *goalRow = goalDistance_->data() + y * nx_;
+  const size_t packed =
+      (x1 - x0 + Pack::width - 1) / Pack::width * Pack::width;
+  // Bit k is set for candidates
+  std::uint32_t candidates = 0;
+  const std::uint32_t eligibles = eligible(y, x0, x1);
+  for (size_t k = 0; k < packed; ++k) {
+    g[k] = goal[k] = dx[k] = dy[k] = 0.0;
+    const size_t x = x0 + k;
+    if (x < x1) {
+      g[k] = traits::toDouble(visibility_global_(x, y));
+      goal[k] = goalRow[x];
+      if (g[k] >= visibilityThreshold_ && ((eligibles >> k) & 1) &&
+          !isLightSource_(x, y)) {
+        const point &parent = lightSources_[cameFrom_(x, y)];
+        dx[k] = static_cast<int>(x) - parent.first;
+        dy[k] = static_cast<int>(y) - parent.second;
+        candidates |= std::uint32_t(1) << k;
+      }
+    }
+  }
+  const Pack scale = Pack::set1(scale_);
+  for (size_t k = 0; k < packed; k += Pack::width) {
+    const Pack px = Pack::loadu(dx + k);
+    const Pack py = Pack::loadu(dy + k);
+    const Pack parent = sqrt(px * px + py * py);
+    (scale * Pack::loadu(g + k) + (Pack::loadu(goal + k) + parent))
+        .storeu(h + k);
+  }
+  for (size_t k = 0; k < x1 - x0; ++k) {
+    if (!((candidates >> k) & 1)) {
+      h[k] = std::numeric_limits<double>::infinity();
+    }
+  }
 }
 
 /*****************************************************************************/
 /*****************************************************************************/
 /*****************************************************************************/
-void visibilityBasedSolver::solve() {
+template <typename T>
+void visibilityBasedSolver<T>::solve() {
   auto time_start = std::chrono::high_resolution_clock::now();
 
   // Init
@@ -115,30 +307,9 @@ void visibilityBasedSolver::solve() {
     return;
   }
 
-  ls_ = start;
-  end_ = end;
-
-  lightSources_[nb_of_sources_] = start;
-  cameFrom_(start.first, start.second) = nb_of_sources_;
-  visibility_global_(end.first, end.second) = 0;
-  max_iter_ = sharedConfig_->max_iter;
-  visibilityThreshold_ = sharedConfig_->visibilityThreshold;
-
-  while (visibility_global_(end.first, end.second) <= visibilityThreshold_) {
-    resetQueue();
-    updateVisibility();
-    auto node = heap_->top();
-    ls_ = {node.x, node.y};
-    ++nb_of_sources_;
-    lightSources_[nb_of_sources_] = ls_;
-    if (nb_of_sources_ > max_iter_) {
-      std::cout << "Max iters hit. Solution could not be found. Try lowering "
-                   "visibility threshold."
-                << std::endl;
-      return;
-    }
+  if (!plan(start, end)) {
+    return;
   }
-  lightSources_[nb_of_sources_] = end;
 
   auto time_stop = std::chrono::high_resolution_clock::now();
   auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
@@ -150,6 +321,7 @@ void visibilityBasedSolver::solve() {
                 << "\n"
                 << "Execution time in us: " << duration.count() << "us"
                 << std::endl;
+      printIterationTimings();
     }
   }
   saveResults();
@@ -162,7 +334,121 @@ void visibilityBasedSolver::solve() {
 /*****************************************************************************/
 /*****************************************************************************/
 /*****************************************************************************/
-void visibilityBasedSolver::standAloneVisibility() {
+template <typename T>
+double visibilityBasedSolver<T>::solve(const point &start, const point &goal,
+                                       std::vector<point> &path) {
+  path.clear();
+  if (!isValid(start.first, start.second) ||
+      !isValid(goal.first, goal.second) ||
+      !occupancyComplement_->get(start.first, start.second) ||
+      !occupancyComplement_->get(goal.first, goal.second) ||
+      !plan(start, goal)) {
+    return std::numeric_limits<double>::infinity();
+  }
+  return tracePath(goal, path);
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+template <typename T>
+bool visibilityBasedSolver<T>::plan(const point &start, const point &end) {
+  end_ = end;
+  max_iter_ = sharedConfig_->max_iter;
+  // Released first, so that the cache can reuse the field for a new goal
+  goalDistance_.reset();
+  goalDistance_ = goalDistanceCache_->get(end_, nx_, ny_);
+  if (lightSources_.size() < max_iter_ + 2) {
+    lightSources_.resize(max_iter_ + 2);
+    iterationTimings_.reserve(max_iter_ + 1);
+  }
+  visibilityThreshold_ = sharedConfig_->visibilityThreshold;
+
+  if (sharedConfig_->cornerPivots) {
+    cornerPivots_ = true;
+    if (search(start, end)) {
+      return true;
+    }
+    if (!sharedConfig_->silent) {
+      std::cout << "Corner pivots could not reach the goal, solving again "
+                   "scoring every cell."
+                << std::endl;
+    }
+  }
+  cornerPivots_ = false;
+  return search(start, end);
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+template <typename T>
+bool visibilityBasedSolver<T>::search(const point &start, const point &end) {
+  restart();
+  ls_ = start;
+  lightSources_[nb_of_sources_] = start;
+  cameFrom_(start.first, start.second) = nb_of_sources_;
+  isLightSource_(start.first, start.second) = true;
+  visibility_global_(end.first, end.second) = 0;
+  markFolded({static_cast<size_t>(start.first),
+              static_cast<size_t>(start.first) + 1,
+              static_cast<size_t>(start.second),
+              static_cast<size_t>(start.second) + 1});
+  iterationTimings_.clear();
+
+  while (traits::toDouble(visibility_global_(end.first, end.second)) <=
+         visibilityThreshold_) {
+    updateVisibility();
+    if (pivot_.h == std::numeric_limits<double>::infinity()) {
+      if (!sharedConfig_->silent && !cornerPivots_) {
+        std::cout << "No cell is visible enough to be a pivot. Solution "
+                     "could not be found. Try lowering visibility threshold."
+                  << std::endl;
+      }
+      return false;
+    }
+    ls_ = {pivot_.x, pivot_.y};
+    isLightSource_(pivot_.x, pivot_.y) = true;
+    pivotIndex_.invalidate(pivotIndex_.tileOf(pivot_.x, pivot_.y));
+    ++nb_of_sources_;
+    lightSources_[nb_of_sources_] = ls_;
+    if (nb_of_sources_ > max_iter_) {
+      if (!sharedConfig_->silent && !cornerPivots_) {
+        std::cout << "Max iters hit. Solution could not be found. Try "
+                     "lowering visibility threshold."
+                  << std::endl;
+      }
+      return false;
+    }
+  }
+  lightSources_[nb_of_sources_] = end;
+  return true;
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+template <typename T> void visibilityBasedSolver<T>::restart() {
+  // Only the windows folded since the last restart differ from a fresh
+  // solver, a solve with a limited range leaves the rest of the grid alone
+  const size_t width = folded_.xEnd - folded_.xBegin;
+  for (size_t y = folded_.yBegin; y < folded_.yEnd; ++y) {
+    const size_t begin = folded_.xBegin + y * nx_;
+    std::fill_n(visibility_global_.data() + begin, width,
+                traits::fromDouble(0.0));
+    std::fill_n(cameFrom_.data() + begin, width, 1e15);
+    std::fill_n(isLightSource_.data() + begin, width, false);
+  }
+  folded_ = {0, 0, 0, 0};
+  pivotIndex_.reset(nx_, ny_);
+  nb_of_sources_ = 0;
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+template <typename T>
+void visibilityBasedSolver<T>::standAloneVisibility() {
   // Init
   auto start = sharedConfig_->start;
 
@@ -184,6 +470,7 @@ void visibilityBasedSolver::standAloneVisibility() {
 
   ls_ = start;
   visibilityThreshold_ = sharedConfig_->visibilityThreshold;
+  goalDistance_.reset();
   updateVisibility();
   saveStandAloneVisibility();
 }
@@ -191,7 +478,8 @@ void visibilityBasedSolver::standAloneVisibility() {
 /*****************************************************************************/
 /*****************************************************************************/
 /*****************************************************************************/
-void visibilityBasedSolver::benchmark() {
+template <typename T>
+void visibilityBasedSolver<T>::benchmark() {
   // Init
   auto start = sharedConfig_->start;
 
@@ -249,13 +537,9 @@ void visibilityBasedSolver::benchmark() {
               << " faster than typical raycasting." << std::endl;
   }
 
-  int count = 0;
-  for (size_t i = 0; i < nx_; ++i) {
-    for (size_t j = 0; j < ny_; ++j) {
-      if (occupancyComplement_->get(i, j) == 0) {
-        ++count;
-      }
-    }
+  size_t count = 0;
+  for (size_t j = 0; j < ny_; ++j) {
+    count += nx_ - occupancyComplement_->countFree(j, 0, nx_);
   }
   std::cout << "Density of the occupancy grid: "
             << (double)count / (nx_ * ny_) * 100 << "%" << std::endl;
@@ -264,7 +548,8 @@ void visibilityBasedSolver::benchmark() {
 /*****************************************************************************/
 /*****************************************************************************/
 /*****************************************************************************/
-void visibilityBasedSolver::raycasting(int x0, int y0, int x1, int y1) {
+template <typename T>
+void visibilityBasedSolver<T>::raycasting(int x0, int y0, int x1, int y1) {
   int dx = std::abs(x1 - x0);
   int dy = std::abs(y1 - y0);
   int sx = (x0 < x1) ? 1 : -1;
@@ -292,7 +577,8 @@ void visibilityBasedSolver::raycasting(int x0, int y0, int x1, int y1) {
 /*****************************************************************************/
 /*****************************************************************************/
 /*****************************************************************************/
-void visibilityBasedSolver::benchmarkSeries() {
+template <typename T>
+void visibilityBasedSolver<T>::benchmarkSeries() {
   visibilityThreshold_ = sharedConfig_->visibilityThreshold;
 
   const int num_points = 60;
@@ -319,7 +605,7 @@ void visibilityBasedSolver::benchmarkSeries() {
 
     visibility_.resize(i, i, 0.0);
     visibilityRayCasting_.resize(i, i, 1.0);
-    occupancyComplement_->resize(i, i, 1.0);
+    occupancyComplement_->resize(i, i, true);
 
     ls_ = {i / 2, i / 2};
     nx_ = i;
@@ -356,218 +642,929 @@ void visibilityBasedSolver::benchmarkSeries() {
     times_raycasting.push_back(duration2.count());
     ratios.push_back((double)duration2.count() / duration.count());
   }
-
-  std::cout << "############################## Solver output "
-               "##############################"
-            << "\n"
-            << "Ratios: " << std::endl;
-  for (auto &r : ratios) {
-    std::cout << r << std::endl;
+
+  std::cout << "############################## Solver output "
+               "##############################"
+            << "\n"
+            << "Ratios: " << std::endl;
+  for (auto &r : ratios) {
+    std::cout << r << std::endl;
+  }
+
+  std::ofstream file("output/benchmark_results.txt", std::ios::app);
+  for (size_t i = 0; i < ratios.size(); ++i) {
+    file << times_visibility[i] << " " << times_raycasting[i] << " "
+         << ratios[i] << " " << logarithmic_points[i] << "x"
+         << logarithmic_points[i] << std::endl;
+  }
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+template <typename T>
+void visibilityBasedSolver<T>::benchmarkTraversal() {
+  // Init
+  auto start = sharedConfig_->start;
+
+  // check if start is valid
+  if (!isValid(start.first, start.second)) {
+    std::cout << "############################## Solver output "
+                 "##############################"
+              << std::endl;
+    std::cout << "Start point is out of bounds." << std::endl;
+    return;
+  }
+  if (occupancyComplement_->get(start.first, start.second) == 0) {
+    std::cout << "############################## Solver output "
+                 "##############################"
+              << std::endl;
+    std::cout << "Start point is not valid (occupied)" << std::endl;
+    return;
+  }
+
+  ls_ = start;
+  const int repetitions = 10;
+
+  visibility_.resize(nx_, ny_, 0.0);
+  auto time_start = std::chrono::high_resolution_clock::now();
+  for (int r = 0; r < repetitions; ++r) {
+    computeVisibilityColumnMajor();
+  }
+  auto time_stop = std::chrono::high_resolution_clock::now();
+  auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+      time_stop - time_start);
+
+  Field<double> reference(nx_, ny_, 0.0);
+  for (size_t k = 0; k < visibility_.size(); ++k) {
+    reference.data()[k] = traits::toDouble(visibility_.data()[k]);
+  }
+
+  // Row-major sweep with the portable scalar pack
+  visibility_.resize(nx_, ny_, 0.0);
+  auto time_start2 = std::chrono::high_resolution_clock::now();
+  for (int r = 0; r < repetitions; ++r) {
+    sweepAxes(visibility_, *occupancyComplement_, ls_, lightStrength_);
+    for (const auto &quadrant : quadrantsAround(ls_, nx_, ny_)) {
+      sweepQuadrant<T, simd::scalarPack<T>>(
+          visibility_, *occupancyComplement_, ls_, quadrant,
+          [](size_t, size_t, size_t) {});
+    }
+  }
+  auto time_stop2 = std::chrono::high_resolution_clock::now();
+  auto duration2 = std::chrono::duration_cast<std::chrono::microseconds>(
+      time_stop2 - time_start2);
+
+  // Row-major sweep with the widest pack of the target, on the thread pool
+  visibility_.resize(nx_, ny_, 0.0);
+  auto time_start3 = std::chrono::high_resolution_clock::now();
+  for (int r = 0; r < repetitions; ++r) {
+    computeVisibility();
+  }
+  auto time_stop3 = std::chrono::high_resolution_clock::now();
+  auto duration3 = std::chrono::duration_cast<std::chrono::microseconds>(
+      time_stop3 - time_start3);
+
+  double maxDifference = 0;
+  for (size_t k = 0; k < visibility_.size(); ++k) {
+    const double v = traits::toDouble(visibility_.data()[k]);
+    maxDifference = std::max(maxDifference, std::abs(v - reference.data()[k]));
+  }
+
+  // Every cell reads its occupancy bit and writes its visibility once per
+  // sweep, neighbour reads are served from cache.
+  const double cells = static_cast<double>(nx_ * ny_) * repetitions;
+  const double bytes = (sizeof(T) + 1.0 / 8) * cells;
+  const double columnMajorTime = duration.count() / (double)repetitions;
+  const double scalarTime = duration2.count() / (double)repetitions;
+  const double vectorTime = duration3.count() / (double)repetitions;
+  std::cout << "############################## Solver output "
+               "##############################"
+            << "\n"
+            << "Grid size: " << nx_ << "x" << ny_ << ", " << traits::name
+            << " visibility\n"
+            << "Column-major sweep time in us: " << columnMajorTime << "us ("
+            << cells / duration.count() << " Mcells/s, "
+            << bytes / duration.count() / 1e3 << " GB/s)\n"
+            << "Row-major scalar sweep time in us: " << scalarTime << "us ("
+            << cells / duration2.count() << " Mcells/s, "
+            << bytes / duration2.count() / 1e3 << " GB/s)\n"
+            << "Row-major " << simd::nativePack<T>::width
+            << "-lane sweep on " << pool_->size()
+            << " thread(s) time in us: " << vectorTime << "us ("
+            << cells / duration3.count() << " Mcells/s, "
+            << bytes / duration3.count() / 1e3 << " GB/s)\n"
+            << "Ratio. Vector sweep is: " << columnMajorTime / vectorTime
+            << " faster than the column-major sweep and "
+            << scalarTime / vectorTime << " faster than the scalar sweep.\n"
+            << "Max absolute difference: " << maxDifference << std::endl;
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+template <typename T>
+void visibilityBasedSolver<T>::updateVisibility() {
+  auto time_start = std::chrono::high_resolution_clock::now();
+  const Window window = startSweep();
+  markFolded(window);
+
+  const auto quadrants = quadrantsAround(ls_, nx_, ny_, windowRadius());
+  sweepWorkspace_.partition(quadrants, pool_->size());
+  // Only ever grown, a sweep with fewer blocks would drop the capacity of the
+  // lists past its last block
+  const size_t blocks = sweepWorkspace_.blocks().size();
+  if (blockUpdates_.size() < blocks) {
+    blockUpdates_.resize(blocks);
+  }
+  for (size_t k = 0; k < blocks; ++k) {
+    blockUpdates_[k].updates.clear();
+    blockUpdates_[k].changed = 0;
+    blockUpdates_[k].scored = 0;
+  }
+
+  // Fold every completed row into the global visibility and the parent map
+  // while it is still in cache. The heuristic of a cell only changes when its
+  // global visibility rises: a cell that becomes a candidate is offered to
+  // its tile of the pivot index, and a candidate that gets worse only matters
+  // if it was the best of its tile. Blocks own disjoint cells and only read
+  // the index, so they can do this concurrently. With corner pivots only the
+  // corner cells are offered.
+  const bool selectPivot = goalDistance_ != nullptr;
+  auto updateRow = [this, selectPivot](size_t block, size_t y, size_t xBegin,
+                                       size_t xEnd) {
+    BlockUpdates &blockUpdate = blockUpdates_[block];
+    for (size_t x0 = xBegin; x0 < xEnd;) {
+      const size_t x1 = std::min(
+          xEnd, (x0 / PivotIndex::tileSize + 1) * PivotIndex::tileSize);
+      const size_t tile = pivotIndex_.tileOf(x0, y);
+      const Node &tileBest = pivotIndex_.tileBest(tile);
+      // Bit x - x0 is set for cells that became candidates
+      std::uint32_t fresh = 0;
+      bool worse = false;
+      for (size_t x = x0; x < x1; ++x) {
+        const CellChange change = foldCell(x, y);
+        if (change == CellChange::risen) {
+          ++blockUpdate.changed;
+          worse |= x == tileBest.x && y == tileBest.y;
+        } else if (change == CellChange::fresh) {
+          ++blockUpdate.changed;
+          fresh |= std::uint32_t(1) << (x - x0);
+        }
+      }
+      if (selectPivot) {
+        fresh &= eligible(y, x0, x1);
+      }
+      if (selectPivot && (worse || fresh != 0)) {
+        Node best = PivotIndex::none();
+        if (fresh != 0) {
+          blockUpdate.scored += std::popcount(fresh);
+          alignas(64) double h[PivotIndex::tileSize];
+          heuristics(y, x0, x1, h);
+          for (; fresh != 0; fresh &= fresh - 1) {
+            const size_t k = std::countr_zero(fresh);
+            const Node candidate{x0 + k, y, h[k]};
+            if (precedes(candidate, best)) {
+              best = candidate;
+            }
+          }
+        }
+        // Every other cell of the tile is at least as bad as the old best, so
+        // a new candidate beating it is the new best without a rescan
+        if (worse && precedes(best, tileBest)) {
+          worse = false;
+        }
+        blockUpdate.updates.push_back({tile, best, worse});
+      }
+      x0 = x1;
+    }
+  };
+  auto time_sweep = std::chrono::high_resolution_clock::now();
+  if (!isRanged()) {
+    sweepQuadrantsParallel(*pool_, sweepWorkspace_, visibility_,
+                           *occupancyComplement_, ls_, quadrants, updateRow);
+  } else {
+    // The range applies to the finished sweep, as the sweep reads the rows
+    // it has written. The window is folded afterwards.
+    sweepQuadrantsParallel(*pool_, sweepWorkspace_, visibility_,
+                           *occupancyComplement_, ls_, quadrants,
+                           [](size_t, size_t, size_t, size_t) {});
+    applyRange(visibility_, ls_, window);
+    for (size_t y = window.yBegin; y < window.yEnd; ++y) {
+      updateRow(0, y, window.xBegin, window.xEnd);
+    }
+  }
+  auto time_select = std::chrono::high_resolution_clock::now();
+
+  // Apply the tile updates of all blocks, then rescan the tiles whose best got
+  // worse. The order is strict, so the pivot does not depend on the partition.
+  size_t changed = 0;
+  size_t scored = 0;
+  for (size_t k = 0; k < blocks; ++k) {
+    const BlockUpdates &block = blockUpdates_[k];
+    for (const auto &update : block.updates) {
+      if (update.invalidate) {
+        pivotIndex_.invalidate(update.tile);
+      } else {
+        pivotIndex_.offer(update.tile, update.best);
+      }
+    }
+    changed += block.changed;
+    scored += block.scored;
+  }
+  const size_t rescans = pivotIndex_.update(
+      *pool_, nx_, ny_, [this](size_t y, size_t x0, size_t x1, double *h) {
+        heuristics(y, x0, x1, h);
+      });
+  pivot_ = pivotIndex_.best();
+  auto time_stop = std::chrono::high_resolution_clock::now();
+
+  auto us = [](auto from, auto to) {
+    return std::chrono::duration<double, std::micro>(to - from).count();
+  };
+  iterationTimings_.push_back({us(time_start, time_sweep),
+                               us(time_sweep, time_select),
+                               us(time_select, time_stop), changed, rescans,
+                               scored});
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+template <typename T>
+void visibilityBasedSolver<T>::printIterationTimings() const {
+  if (iterationTimings_.empty()) {
+    return;
+  }
+  IterationTiming total{0, 0, 0, 0, 0, 0};
+  for (const auto &timing : iterationTimings_) {
+    total.reset += timing.reset;
+    total.sweep += timing.sweep;
+    total.select += timing.select;
+    total.changed += timing.changed;
+    total.rescans += timing.rescans;
+    total.scored += timing.scored;
+  }
+  const double n = static_cast<double>(iterationTimings_.size());
+  std::cout << "Iterations: " << iterationTimings_.size() << "\n"
+            << "Mean time per iteration in us: reset " << total.reset / n
+            << "us, sweep " << total.sweep / n << "us, pivot selection "
+            << total.select / n << "us\n"
+            << "Mean changed candidates per iteration: " << total.changed / n
+            << ", scored " << total.scored / n << ", rescanned tiles "
+            << total.rescans / n << std::endl;
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+template <typename T>
+void visibilityBasedSolver<T>::computeVisibility() {
+  const Window window = startSweep();
+  const auto quadrants = quadrantsAround(ls_, nx_, ny_, windowRadius());
+  sweepWorkspace_.partition(quadrants, pool_->size());
+  sweepQuadrantsParallel(*pool_, sweepWorkspace_, visibility_,
+                         *occupancyComplement_, ls_, quadrants,
+                         [](size_t, size_t, size_t, size_t) {});
+  if (isRanged()) {
+    applyRange(visibility_, ls_, window);
+  }
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+template <typename T>
+void visibilityBasedSolver<T>::computeVisibility(const point &source) {
+  ls_ = source;
+  computeVisibility();
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+template <typename T>
+void visibilityBasedSolver<T>::computeVisibility(const point &source,
+                                                 const double heading,
+                                                 const double aperture) {
+  ls_ = source;
+  sweepSector(Sector(heading, aperture));
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+template <typename T>
+void visibilityBasedSolver<T>::sweepSector(const Sector &sector) {
+  const auto quadrants = quadrantsAround(ls_, nx_, ny_, windowRadius(), sector,
+                                         simd::nativePack<T>::width);
+  const Window window = windowOf(ls_, quadrants);
+  // The cut quadrants leave parts of their window unswept
+  startSweep(window, true);
+  sector_.emplace(sector);
+  sweepWorkspace_.partition(quadrants, pool_->size());
+  sweepQuadrantsParallel(*pool_, sweepWorkspace_, visibility_,
+                         *occupancyComplement_, ls_, quadrants,
+                         [](size_t, size_t, size_t, size_t) {});
+  applyRange(visibility_, ls_, window, &sector);
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+template <typename T>
+size_t visibilityBasedSolver<T>::repairVisibility(
+    const std::vector<CellUpdate> &updates) {
+  // The sector cuts the quadrants and darkens the cells outside of it once
+  // the sweep is done, so it is swept again whole
+  if (sector_) {
+    const Sector sector = *sector_;
+    sweepSector(sector);
+    return 0;
+  }
+  return repairVisibility(updates, ls_, visibility_);
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+template <typename T>
+size_t visibilityBasedSolver<T>::repairVisibility(
+    const std::vector<CellUpdate> &updates, const point &source,
+    Field<T> &field) const {
+  // The range applies to the finished sweep, so it is swept again whole. It
+  // only covers the window of the range.
+  if (isRanged()) {
+    sweepSource(field, source, [](size_t, size_t, size_t) {});
+    applyRange(field, source, windowAround(source, nx_, ny_, windowRadius()));
+    return 0;
+  }
+  const size_t x0 = source.first;
+  const size_t y0 = source.second;
+  // The axes are cheap to transport again, their cells that changed seed the
+  // repair along with the cells of the update
+  std::vector<T> row(field.data() + y0 * nx_, field.data() + (y0 + 1) * nx_);
+  std::vector<T> column(ny_);
+  for (size_t y = 0; y < ny_; ++y) {
+    column[y] = field(x0, y);
+  }
+  sweepAxes(field, *occupancyComplement_, source, lightStrength_);
+
+  size_t resweeps = 0;
+  std::vector<std::pair<size_t, size_t>> cells;
+  for (const auto &q : quadrantsAround(source, nx_, ny_)) {
+    cells.clear();
+    // Local column and row of (x, y) if it is in the quadrant
+    auto add = [&](const size_t x, const size_t y) {
+      const size_t i = q.dx > 0 ? x - x0 : x0 - x;
+      const size_t j = q.dy > 0 ? y - y0 : y0 - y;
+      if (i < q.extentX && j < q.extentY) {
+        cells.push_back({i, j});
+      }
+    };
+    for (const auto &update : updates) {
+      if (isValid(update.x, update.y)) {
+        add(update.x, update.y);
+      }
+    }
+    for (size_t x = 0; x < nx_; ++x) {
+      if (field(x, y0) != row[x]) {
+        add(x, y0);
+      }
+    }
+    for (size_t y = 0; y < ny_; ++y) {
+      if (field(x0, y) != column[y]) {
+        add(x0, y);
+      }
+    }
+    resweeps +=
+        repairQuadrant(field, *occupancyComplement_, source, q, cells);
+  }
+  return resweeps;
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+template <typename T>
+void visibilityBasedSolver<T>::computeVisibilityBatch(
+    const std::vector<point> &sources, std::vector<Field<T>> &fields) {
+  fields.resize(sources.size());
+  // The sweeps write every cell, so fields are only allocated, not cleared,
+  // unless the range limits the sweeps to a window
+  pool_->run(sources.size(), [&](const size_t k) {
+    if (fields[k].nx() != nx_ || fields[k].ny() != ny_) {
+      fields[k].resize(nx_, ny_, 0.0);
+    } else if (radius_ > 0) {
+      fields[k].fill(traits::fromDouble(0.0));
+    }
+    sweepSource(fields[k], sources[k], [](size_t, size_t, size_t) {});
+    if (isRanged()) {
+      applyRange(fields[k], sources[k],
+                 windowAround(sources[k], nx_, ny_, windowRadius()));
+    }
+  });
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+template <typename T>
+void visibilityBasedSolver<T>::computeVisibilityBatch(
+    const std::vector<point> &sources, const double threshold,
+    Coverage &coverage) {
+  const size_t threads =
+      std::max<size_t>(1, std::min(pool_->size(), sources.size()));
+  batchVisibility_.resize(threads);
+  batchCoverage_.resize(threads - 1);
+  auto coverageOf = [&](const size_t t) -> Coverage & {
+    return t == 0 ? coverage : batchCoverage_[t - 1];
+  };
+
+  // Thread t takes a contiguous share of the sources and folds every swept
+  // run of a row into its own maps while the run is in cache
+  pool_->run(threads, [&](const size_t t) {
+    Field<T> &visibility = batchVisibility_[t];
+    Coverage &own = coverageOf(t);
+    if (visibility.nx() != nx_ || visibility.ny() != ny_) {
+      visibility.resize(nx_, ny_, 0.0);
+    }
+    if (own.visibility.nx() != nx_ || own.visibility.ny() != ny_) {
+      own.visibility.resize(nx_, ny_, 0.0);
+      own.count.resize(nx_, ny_, 0);
+    } else {
+      own.visibility.fill(traits::fromDouble(0.0));
+      own.count.fill(0);
+    }
+    const point *source = nullptr;
+    auto fold = [&](const size_t y, const size_t xBegin, const size_t xEnd) {
+      for (size_t x = xBegin; x < xEnd; ++x) {
+        const T v = isRanged() ? ranged(x, y, *source, visibility(x, y))
+                               : visibility(x, y);
+        T &best = own.visibility(x, y);
+        best = std::max(best, v);
+        own.count(x, y) += traits::toDouble(v) >= threshold;
+      }
+    };
+    const size_t begin = t * sources.size() / threads;
+    const size_t end = (t + 1) * sources.size() / threads;
+    for (size_t k = begin; k < end; ++k) {
+      source = &sources[k];
+      sweepSource(visibility, sources[k], fold);
+    }
+  });
+
+  // Merge the maps of the other threads into the result, a row per task
+  if (threads > 1) {
+    pool_->run(ny_, [&](const size_t y) {
+      for (size_t t = 1; t < threads; ++t) {
+        const Coverage &other = batchCoverage_[t - 1];
+        for (size_t x = 0; x < nx_; ++x) {
+          coverage.visibility(x, y) =
+              std::max(coverage.visibility(x, y), other.visibility(x, y));
+          coverage.count(x, y) += other.count(x, y);
+        }
+      }
+    });
+  }
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+template <typename T>
+void visibilityBasedSolver<T>::benchmarkBatch(const size_t nbSources) {
+  if (occupancyComplement_->size() == 0) {
+    return;
+  }
+  size_t freeCells = 0;
+  for (size_t j = 0; j < ny_; ++j) {
+    freeCells += occupancyComplement_->countFree(j, 0, nx_);
+  }
+  if (freeCells == 0) {
+    std::cout << "############################## Solver output "
+                 "##############################"
+              << std::endl;
+    std::cout << "No free cell to place light sources on." << std::endl;
+    return;
+  }
+
+  // Random free cells, the same ones on every run
+  std::mt19937 generator(1);
+  std::vector<point> sources;
+  while (sources.size() < nbSources) {
+    const size_t x = generator() % nx_;
+    const size_t y = generator() % ny_;
+    if (occupancyComplement_->get(x, y)) {
+      sources.push_back({static_cast<int>(x), static_cast<int>(y)});
+    }
+  }
+  const double threshold = visibilityThreshold_;
+
+  // One source at a time, each sweep spread over the threads
+  Coverage reference;
+  reference.visibility.resize(nx_, ny_, 0.0);
+  reference.count.resize(nx_, ny_, 0);
+  auto time_start = std::chrono::high_resolution_clock::now();
+  for (const point &source : sources) {
+    computeVisibility(source);
+    for (size_t k = 0; k < visibility_.size(); ++k) {
+      const T v = visibility_.data()[k];
+      T &best = reference.visibility.data()[k];
+      best = std::max(best, v);
+      reference.count.data()[k] += traits::toDouble(v) >= threshold;
+    }
+  }
+  auto time_stop = std::chrono::high_resolution_clock::now();
+  auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+      time_stop - time_start);
+
+  Coverage coverage;
+  auto time_start2 = std::chrono::high_resolution_clock::now();
+  computeVisibilityBatch(sources, threshold, coverage);
+  auto time_stop2 = std::chrono::high_resolution_clock::now();
+  auto duration2 = std::chrono::duration_cast<std::chrono::microseconds>(
+      time_stop2 - time_start2);
+
+  double maxDifference = 0;
+  size_t countMismatches = 0;
+  for (size_t k = 0; k < coverage.visibility.size(); ++k) {
+    maxDifference = std::max(
+        maxDifference,
+        std::abs(traits::toDouble(coverage.visibility.data()[k]) -
+                 traits::toDouble(reference.visibility.data()[k])));
+    countMismatches += coverage.count.data()[k] != reference.count.data()[k];
+  }
+
+  std::cout << "############################## Solver output "
+               "##############################"
+            << "\n"
+            << "Sources: " << sources.size() << " on a " << nx_ << "x" << ny_
+            << " grid, " << pool_->size() << " thread(s)\n"
+            << "One at a time time in us: " << duration.count() << "us\n"
+            << "Batch time in us: " << duration2.count() << "us\n"
+            << "Ratio. Batch is: "
+            << (double)duration.count() / duration2.count()
+            << " faster than one source at a time.\n"
+            << "Max absolute difference: " << maxDifference
+            << ", cells with a different count: " << countMismatches
+            << std::endl;
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+template <typename T>
+double visibilityBasedSolver<T>::visibilityBetween(const point &a,
+                                                   const point &b) {
+  lazyVisibility_.resize(nx_, ny_);
+  const T v =
+      lazyVisibility_.at(*occupancyComplement_, a, lightStrength_, b);
+  return traits::toDouble(isRanged() ? ranged(b.first, b.second, a, v) : v);
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+template <typename T>
+void visibilityBasedSolver<T>::benchmarkVisibilityBetween(
+    const size_t nbQueries) {
+  if (occupancyComplement_->size() == 0) {
+    return;
+  }
+  size_t freeCells = 0;
+  for (size_t j = 0; j < ny_; ++j) {
+    freeCells += occupancyComplement_->countFree(j, 0, nx_);
+  }
+  if (freeCells == 0) {
+    std::cout << "############################## Solver output "
+                 "##############################"
+              << std::endl;
+    std::cout << "No free cell to query." << std::endl;
+    return;
+  }
+
+  // Random free cells, the same ones on every run
+  std::mt19937 generator(1);
+  auto randomFreeCell = [&]() {
+    while (true) {
+      const size_t x = generator() % nx_;
+      const size_t y = generator() % ny_;
+      if (occupancyComplement_->get(x, y)) {
+        return point{static_cast<int>(x), static_cast<int>(y)};
+      }
+    }
+  };
+  std::vector<std::pair<point, point>> pairs(nbQueries);
+  for (auto &[a, b] : pairs) {
+    a = randomFreeCell();
+    b = randomFreeCell();
+  }
+  // Pairs of cells at most 32 columns and rows apart
+  std::vector<std::pair<point, point>> nearPairs(nbQueries);
+  for (auto &[a, b] : nearPairs) {
+    a = randomFreeCell();
+    const int x = a.first + static_cast<int>(generator() % 65) - 32;
+    const int y = a.second + static_cast<int>(generator() % 65) - 32;
+    b = {std::clamp(x, 0, static_cast<int>(nx_) - 1),
+         std::clamp(y, 0, static_cast<int>(ny_) - 1)};
+  }
+
+  std::vector<double> lazy(nbQueries);
+  auto time_start = std::chrono::high_resolution_clock::now();
+  for (size_t k = 0; k < nbQueries; ++k) {
+    lazy[k] = visibilityBetween(pairs[k].first, pairs[k].second);
+  }
+  auto time_stop = std::chrono::high_resolution_clock::now();
+  auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+      time_stop - time_start);
+
+  auto time_start2 = std::chrono::high_resolution_clock::now();
+  for (const auto &[a, b] : pairs) {
+    raycasting(a.first, a.second, b.first, b.second);
+  }
+  auto time_stop2 = std::chrono::high_resolution_clock::now();
+  auto duration2 = std::chrono::duration_cast<std::chrono::microseconds>(
+      time_stop2 - time_start2);
+
+  auto time_start6 = std::chrono::high_resolution_clock::now();
+  double nearSum = 0;
+  for (const auto &[a, b] : nearPairs) {
+    nearSum += visibilityBetween(a, b);
+  }
+  auto time_stop6 = std::chrono::high_resolution_clock::now();
+  auto duration6 = std::chrono::duration_cast<std::chrono::microseconds>(
+      time_stop6 - time_start6);
+  auto time_start7 = std::chrono::high_resolution_clock::now();
+  for (const auto &[a, b] : nearPairs) {
+    raycasting(a.first, a.second, b.first, b.second);
+  }
+  auto time_stop7 = std::chrono::high_resolution_clock::now();
+  auto duration7 = std::chrono::duration_cast<std::chrono::microseconds>(
+      time_stop7 - time_start7);
+
+  // A sweep per pair, on fewer pairs
+  const size_t nbSweeps = std::min<size_t>(nbQueries, 50);
+  double maxDifference = 0;
+  auto time_start3 = std::chrono::high_resolution_clock::now();
+  for (size_t k = 0; k < nbSweeps; ++k) {
+    computeVisibility(pairs[k].first);
+    maxDifference = std::max(
+        maxDifference,
+        std::abs(lazy[k] - traits::toDouble(
+                               visibility_(pairs[k].second.first,
+                                           pairs[k].second.second))));
+  }
+  auto time_stop3 = std::chrono::high_resolution_clock::now();
+  const double sweepPerPair =
+      std::chrono::duration<double, std::micro>(time_stop3 - time_start3)
+          .count() /
+      nbSweeps;
+
+  // Many cells from one source, the evaluated cells are kept
+  const point source = randomFreeCell();
+  std::vector<point> cells(nbQueries);
+  for (auto &cell : cells) {
+    cell = randomFreeCell();
+  }
+  auto time_start4 = std::chrono::high_resolution_clock::now();
+  for (size_t k = 0; k < nbQueries; ++k) {
+    lazy[k] = visibilityBetween(source, cells[k]);
+  }
+  auto time_stop4 = std::chrono::high_resolution_clock::now();
+  auto duration4 = std::chrono::duration_cast<std::chrono::microseconds>(
+      time_stop4 - time_start4);
+  auto time_start5 = std::chrono::high_resolution_clock::now();
+  computeVisibility(source);
+  auto time_stop5 = std::chrono::high_resolution_clock::now();
+  auto duration5 = std::chrono::duration_cast<std::chrono::microseconds>(
+      time_stop5 - time_start5);
+  for (size_t k = 0; k < nbQueries; ++k) {
+    maxDifference = std::max(
+        maxDifference,
+        std::abs(lazy[k] - traits::toDouble(visibility_(cells[k].first,
+                                                        cells[k].second))));
+  }
+
+  std::cout << "############################## Solver output "
+               "##############################"
+            << "\n"
+            << "Pairs: " << nbQueries << " on a " << nx_ << "x" << ny_
+            << " grid\n"
+            << "visibilityBetween() time per pair in us: "
+            << (double)duration.count() / nbQueries << "us\n"
+            << "Raycasting time per pair in us: "
+            << (double)duration2.count() / nbQueries << "us\n"
+            << "Sweep per pair time in us: " << sweepPerPair << "us\n"
+            << "Pairs at most 32 cells apart, visibilityBetween() time per "
+               "pair in us: "
+            << (double)duration6.count() / nbQueries
+            << "us, raycasting time per pair in us: "
+            << (double)duration7.count() / nbQueries
+            << "us (mean visibility " << nearSum / nbQueries << ")\n"
+            << "Cells from one source: " << nbQueries
+            << ", visibilityBetween() time in us: " << duration4.count()
+            << "us, sweep time in us: " << duration5.count() << "us\n"
+            << "Max absolute difference to the sweep: " << maxDifference
+            << std::endl;
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+template <typename T>
+void visibilityBasedSolver<T>::buildRoadmap(CornerRoadmap &roadmap) {
+  std::vector<point> corners = cornerIndex_->cells();
+  const size_t n = corners.size();
+  // Bit j % 64 of sees[i * words + j / 64] is set if corner i sees corner j
+  const size_t words = (n + 63) / 64;
+  std::vector<std::uint64_t> sees(n * words, 0);
+  // One corner per thread at a time, so only that many fields are kept
+  const size_t batch = std::max<size_t>(1, pool_->size());
+  std::vector<point> sources;
+  std::vector<Field<T>> fields;
+  for (size_t first = 0; first < n; first += batch) {
+    const size_t last = std::min(n, first + batch);
+    sources.assign(corners.begin() + first, corners.begin() + last);
+    computeVisibilityBatch(sources, fields);
+    for (size_t i = first; i < last; ++i) {
+      const Field<T> &field = fields[i - first];
+      for (size_t j = 0; j < n; ++j) {
+        const T v = field(corners[j].first, corners[j].second);
+        if (traits::toDouble(v) >= visibilityThreshold_) {
+          sees[i * words + j / 64] |= std::uint64_t(1) << (j % 64);
+        }
+      }
+    }
+  }
+  auto seen = [&](const size_t i, const size_t j) {
+    return (sees[i * words + j / 64] >> (j % 64)) & 1;
+  };
+  std::vector<std::vector<std::uint32_t>> links(n);
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = i + 1; j < n; ++j) {
+      if (seen(i, j) && seen(j, i)) {
+        links[i].push_back(static_cast<std::uint32_t>(j));
+        links[j].push_back(static_cast<std::uint32_t>(i));
+      }
+    }
+  }
+  roadmap.assign(*occupancyComplement_, visibilityThreshold_,
+                 std::move(corners), links);
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+template <typename T>
+double visibilityBasedSolver<T>::solveOnRoadmap(const CornerRoadmap &roadmap,
+                                                const point &start,
+                                                const point &goal,
+                                                std::vector<point> &path) {
+  path.clear();
+  if (!isValid(start.first, start.second) ||
+      !isValid(goal.first, goal.second)) {
+    std::cerr << "Start or goal is out of bounds." << std::endl;
+    return std::numeric_limits<double>::infinity();
+  }
+  if (!occupancyComplement_->get(start.first, start.second) ||
+      !occupancyComplement_->get(goal.first, goal.second)) {
+    std::cerr << "Start or goal is not valid (occupied)" << std::endl;
+    return std::numeric_limits<double>::infinity();
+  }
+  if (!roadmap.matches(*occupancyComplement_)) {
+    std::cerr << "The roadmap is not the one of the current map, build or "
+                 "load it again"
+              << std::endl;
+    return std::numeric_limits<double>::infinity();
   }
 
-  std::ofstream file("output/benchmark_results.txt", std::ios::app);
-  for (size_t i = 0; i < ratios.size(); ++i) {
-    file << times_visibility[i] << " " << times_raycasting[i] << " "
-         << ratios[i] << " " << logarithmic_points[i] << "x"
-         << logarithmic_points[i] << std::endl;
+  // Corners seen from a cell, in the visibility of the last sweep
+  const double threshold = roadmap.threshold();
+  auto seenCorners = [&](std::vector<std::uint32_t> &seen) {
+    seen.clear();
+    for (size_t i = 0; i < roadmap.nodes(); ++i) {
+      const point &corner = roadmap.node(i);
+      if (traits::toDouble(visibility_(corner.first, corner.second)) >=
+          threshold) {
+        seen.push_back(static_cast<std::uint32_t>(i));
+      }
+    }
+  };
+  computeVisibility(start);
+  if (traits::toDouble(visibility_(goal.first, goal.second)) >= threshold) {
+    path = {start, goal};
+    return eval_d(start.first, start.second, goal.first, goal.second);
   }
+  std::vector<std::uint32_t> fromStart, toGoal;
+  seenCorners(fromStart);
+  computeVisibility(goal);
+  seenCorners(toGoal);
+  return roadmap.search(start, goal, fromStart, toGoal, path);
 }
 
 /*****************************************************************************/
 /*****************************************************************************/
 /*****************************************************************************/
-void visibilityBasedSolver::updateVisibility() {
-  size_t currentX, currentY;
-  double v = 0.0;
-  double h;
-  point parent;
-  double offset = 0.0;
-
-  visibility_.reset();
+template <typename T>
+void visibilityBasedSolver<T>::benchmarkRoadmap(const size_t nbQueries) {
+  size_t freeCells = 0;
+  for (size_t j = 0; j < ny_; ++j) {
+    freeCells += occupancyComplement_->countFree(j, 0, nx_);
+  }
+  if (freeCells == 0) {
+    std::cout << "############################## Solver output "
+                 "##############################"
+              << std::endl;
+    std::cout << "No free cell to query." << std::endl;
+    return;
+  }
 
-  // Q1
-  max_x_ = nx_ - ls_.first;
-  max_y_ = ny_ - ls_.second;
+  CornerRoadmap roadmap;
+  auto time_start = std::chrono::high_resolution_clock::now();
+  buildRoadmap(roadmap);
+  auto time_stop = std::chrono::high_resolution_clock::now();
+  auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+      time_stop - time_start);
 
-  for (size_t i = 0; i < max_x_; ++i) {
-    currentX = ls_.first + i;
-    for (size_t j = 0; j < max_y_; ++j) {
-      currentY = ls_.second + j;
-      if (i == 0 && j == 0) {
-        v = lightStrength_;
-      } else if (i == 0) {
-        v = visibility_(currentX, currentY - 1);
-      } else if (j == 0) {
-        v = visibility_(currentX - 1, currentY);
-      } else if (i > j) {
-        c_ = (double)(currentY - ls_.second + offset) /
-             (currentX - ls_.first + offset);
-        v = visibility_(currentX - 1, currentY) -
-            c_ * (visibility_(currentX - 1, currentY) -
-                  visibility_(currentX - 1, currentY - 1));
-      } else if (j > i) {
-        c_ = (double)(currentX - ls_.first + offset) /
-             (currentY - ls_.second + offset);
-        v = visibility_(currentX, currentY - 1) -
-            c_ * (visibility_(currentX, currentY - 1) -
-                  visibility_(currentX - 1, currentY - 1));
-      }
-      v = v * occupancyComplement_->get(currentX, currentY);
-      visibility_(currentX, currentY) = v;
-      visibility_global_(currentX, currentY) =
-          std::max(v, visibility_global_(currentX, currentY));
-      if (v >= visibilityThreshold_) {
-        if (cameFrom_(currentX, currentY) == 1e15) {
-          cameFrom_(currentX, currentY) = nb_of_sources_;
-        }
-      }
-      if (visibility_global_(currentX, currentY) >= visibilityThreshold_) {
-        parent = lightSources_[cameFrom_(currentX, currentY)];
-        h = (scale_ * visibility_global_(currentX, currentY)) +
-            (eval_d(currentX, currentY, end_.first, end_.second) +
-             eval_d(currentX, currentY, parent.first, parent.second));
-        heap_->push(Node{currentX, currentY, h});
-      }
+  // Save next to the other results, and load it back
+  const std::string path = "./output/roadmap.bin";
+  namespace fs = std::filesystem;
+  fs::path directory = fs::path(path).parent_path();
+  if (!fs::exists(directory)) {
+    if (!fs::create_directories(directory)) {
+      std::cerr << "Failed to create directory " << directory.string()
+                << std::endl;
+      return;
     }
   }
-  // Q2
-  max_x_ = ls_.first;
-  max_y_ = ny_ - ls_.second;
-  for (size_t i = 0; i < max_x_; ++i) {
-    currentX = ls_.first - i;
-    for (size_t j = 0; j < max_y_; ++j) {
-      currentY = ls_.second + j;
-      if (i == 0 && j == 0) {
-        v = lightStrength_;
-      } else if (i == 0) {
-        v = visibility_(currentX, currentY - 1);
-      } else if (j == 0) {
-        v = visibility_(currentX + 1, currentY);
-      } else if (i > j) {
-        c_ = (double)(currentY - ls_.second + offset) /
-             (ls_.first - currentX + offset);
-        v = visibility_(currentX + 1, currentY) -
-            c_ * (visibility_(currentX + 1, currentY) -
-                  visibility_(currentX + 1, currentY - 1));
-      } else if (j > i) {
-        c_ = (double)(ls_.first - currentX + offset) /
-             (currentY - ls_.second + offset);
-        v = visibility_(currentX, currentY - 1) -
-            c_ * (visibility_(currentX, currentY - 1) -
-                  visibility_(currentX + 1, currentY - 1));
-      }
-      v = v * occupancyComplement_->get(currentX, currentY);
-      visibility_(currentX, currentY) = v;
-      visibility_global_(currentX, currentY) =
-          std::max(v, visibility_global_(currentX, currentY));
-      if (v >= visibilityThreshold_) {
-        if (cameFrom_(currentX, currentY) == 1e15) {
-          cameFrom_(currentX, currentY) = nb_of_sources_;
-        }
-      }
-      if (visibility_global_(currentX, currentY) >= visibilityThreshold_) {
-        parent = lightSources_[cameFrom_(currentX, currentY)];
-        h = (scale_ * visibility_global_(currentX, currentY)) +
-            (eval_d(currentX, currentY, end_.first, end_.second) +
-             eval_d(currentX, currentY, parent.first, parent.second));
-        heap_->push(Node{currentX, currentY, h});
-      }
-    }
+  if (!roadmap.save(path)) {
+    return;
   }
-  // Q3
-  max_x_ = ls_.first;
-  max_y_ = ls_.second;
-  for (size_t i = 0; i < max_x_; ++i) {
-    currentX = ls_.first - i;
-    for (size_t j = 0; j < max_y_; ++j) {
-      currentY = ls_.second - j;
-      if (i == 0 && j == 0) {
-        v = lightStrength_;
-      } else if (i == 0) {
-        v = visibility_(currentX, currentY + 1);
-      } else if (j == 0) {
-        v = visibility_(currentX + 1, currentY);
-      } else if (i > j) {
-        c_ = (double)(ls_.second - currentY + offset) /
-             (ls_.first - currentX + offset);
-        v = visibility_(currentX + 1, currentY) -
-            c_ * (visibility_(currentX + 1, currentY) -
-                  visibility_(currentX + 1, currentY + 1));
-      } else if (j > i) {
-        c_ = (double)(ls_.first - currentX + offset) /
-             (ls_.second - currentY + offset);
-        v = visibility_(currentX, currentY + 1) -
-            c_ * (visibility_(currentX, currentY + 1) -
-                  visibility_(currentX + 1, currentY + 1));
-      }
-      v = v * occupancyComplement_->get(currentX, currentY);
-      visibility_(currentX, currentY) = v;
-      visibility_global_(currentX, currentY) =
-          std::max(v, visibility_global_(currentX, currentY));
-      if (v >= visibilityThreshold_) {
-        if (cameFrom_(currentX, currentY) == 1e15) {
-          cameFrom_(currentX, currentY) = nb_of_sources_;
-        }
-      }
-      if (visibility_global_(currentX, currentY) >= visibilityThreshold_) {
-        parent = lightSources_[cameFrom_(currentX, currentY)];
-        h = (scale_ * visibility_global_(currentX, currentY)) +
-            (eval_d(currentX, currentY, end_.first, end_.second) +
-             eval_d(currentX, currentY, parent.first, parent.second));
-        heap_->push(Node{currentX, currentY, h});
+  CornerRoadmap loaded;
+  auto time_start2 = std::chrono::high_resolution_clock::now();
+  if (!loaded.load(path, *occupancyComplement_)) {
+    return;
+  }
+  auto time_stop2 = std::chrono::high_resolution_clock::now();
+  auto duration2 = std::chrono::duration_cast<std::chrono::microseconds>(
+      time_stop2 - time_start2);
+
+  // Random free cells, the same ones on every run
+  std::mt19937 generator(1);
+  auto randomFreeCell = [&]() {
+    while (true) {
+      const size_t x = generator() % nx_;
+      const size_t y = generator() % ny_;
+      if (occupancyComplement_->get(x, y)) {
+        return point{static_cast<int>(x), static_cast<int>(y)};
       }
     }
+  };
+  std::vector<std::pair<point, point>> queries(nbQueries);
+  for (auto &[a, b] : queries) {
+    a = randomFreeCell();
+    b = randomFreeCell();
   }
-  // Q4
-  max_x_ = nx_ - ls_.first;
-  max_y_ = ls_.second;
-  for (size_t i = 0; i < max_x_; ++i) {
-    currentX = ls_.first + i;
-    for (size_t j = 0; j < max_y_; ++j) {
-      currentY = ls_.second - j;
-      if (i == 0 && j == 0) {
-        v = lightStrength_;
-      } else if (i == 0) {
-        v = visibility_(currentX, currentY + 1);
-      } else if (j == 0) {
-        v = visibility_(currentX - 1, currentY);
-      } else if (i > j) {
-        c_ = (double)(ls_.second - currentY + offset) /
-             (currentX - ls_.first + offset);
-        v = visibility_(currentX - 1, currentY) -
-            c_ * (visibility_(currentX - 1, currentY) -
-                  visibility_(currentX - 1, currentY + 1));
-      } else if (j > i) {
-        c_ = (double)(currentX - ls_.first + offset) /
-             (ls_.second - currentY + offset);
-        v = visibility_(currentX, currentY + 1) -
-            c_ * (visibility_(currentX, currentY + 1) -
-                  visibility_(currentX - 1, currentY + 1));
-      }
-      v = v * occupancyComplement_->get(currentX, currentY);
-      visibility_(currentX, currentY) = v;
-      visibility_global_(currentX, currentY) =
-          std::max(v, visibility_global_(currentX, currentY));
-      if (v >= visibilityThreshold_) {
-        if (cameFrom_(currentX, currentY) == 1e15) {
-          cameFrom_(currentX, currentY) = nb_of_sources_;
-        }
-      }
-      if (visibility_global_(currentX, currentY) >= visibilityThreshold_) {
-        parent = lightSources_[cameFrom_(currentX, currentY)];
-        h = (scale_ * visibility_global_(currentX, currentY)) +
-            (eval_d(currentX, currentY, end_.first, end_.second) +
-             eval_d(currentX, currentY, parent.first, parent.second));
-        heap_->push(Node{currentX, currentY, h});
-      }
+  size_t found = 0;
+  double lengths = 0;
+  std::vector<point> route;
+  auto time_start3 = std::chrono::high_resolution_clock::now();
+  for (const auto &[a, b] : queries) {
+    const double length = solveOnRoadmap(loaded, a, b, route);
+    if (!route.empty()) {
+      ++found;
+      lengths += length;
     }
   }
+  auto time_stop3 = std::chrono::high_resolution_clock::now();
+  auto duration3 = std::chrono::duration_cast<std::chrono::microseconds>(
+      time_stop3 - time_start3);
+
+  std::cout << "############################## Solver output "
+               "##############################"
+            << "\n"
+            << "Roadmap of a " << nx_ << "x" << ny_ << " grid: "
+            << roadmap.nodes() << " corners, " << roadmap.links()
+            << " links, " << fs::file_size(path) << " bytes\n"
+            << "Build time in us: " << duration.count()
+            << "us, load time in us: " << duration2.count() << "us\n"
+            << "Queries: " << nbQueries << ", found " << found
+            << ", mean path length " << (found ? lengths / found : 0.0)
+            << "\n"
+            << "Time per query in us: "
+            << (double)duration3.count() / std::max<size_t>(nbQueries, 1)
+            << "us" << std::endl;
 }
 
 /*****************************************************************************/
 /*****************************************************************************/
 /*****************************************************************************/
-void visibilityBasedSolver::computeVisibility() {
+template <typename T>
+void visibilityBasedSolver<T>::computeVisibilityColumnMajor() {
+  auto vis = [this](size_t x, size_t y) {
+    return traits::toDouble(visibility_(x, y));
+  };
   size_t currentX, currentY;
   double v = 0.0;
   double offset = 0.0;
@@ -583,24 +1580,24 @@ void visibilityBasedSolver::computeVisibility() {
       if (i == 0 && j == 0) {
         v = lightStrength_;
       } else if (i == 0) {
-        v = visibility_(currentX, currentY - 1);
+        v = vis(currentX, currentY - 1);
       } else if (j == 0) {
-        v = visibility_(currentX - 1, currentY);
+        v = vis(currentX - 1, currentY);
       } else if (i > j) {
         c_ = (double)(currentY - ls_.second + offset) /
              (currentX - ls_.first + offset);
-        v = visibility_(currentX - 1, currentY) -
-            c_ * (visibility_(currentX - 1, currentY) -
-                  visibility_(currentX - 1, currentY - 1));
+        v = vis(currentX - 1, currentY) -
+            c_ * (vis(currentX - 1, currentY) -
+                  vis(currentX - 1, currentY - 1));
       } else if (j > i) {
         c_ = (double)(currentX - ls_.first + offset) /
              (currentY - ls_.second + offset);
-        v = visibility_(currentX, currentY - 1) -
-            c_ * (visibility_(currentX, currentY - 1) -
-                  visibility_(currentX - 1, currentY - 1));
+        v = vis(currentX, currentY - 1) -
+            c_ * (vis(currentX, currentY - 1) -
+                  vis(currentX - 1, currentY - 1));
       }
       v = v * occupancyComplement_->get(currentX, currentY);
-      visibility_(currentX, currentY) = v;
+      visibility_(currentX, currentY) = traits::fromDouble(v);
     }
   }
   // Q2
@@ -613,24 +1610,24 @@ void visibilityBasedSolver::computeVisibility() {
       if (i == 0 && j == 0) {
         v = lightStrength_;
       } else if (i == 0) {
-        v = visibility_(currentX, currentY - 1);
+        v = vis(currentX, currentY - 1);
       } else if (j == 0) {
-        v = visibility_(currentX + 1, currentY);
+        v = vis(currentX + 1, currentY);
       } else if (i > j) {
         c_ = (double)(currentY - ls_.second + offset) /
              (ls_.first - currentX + offset);
-        v = visibility_(currentX + 1, currentY) -
-            c_ * (visibility_(currentX + 1, currentY) -
-                  visibility_(currentX + 1, currentY - 1));
+        v = vis(currentX + 1, currentY) -
+            c_ * (vis(currentX + 1, currentY) -
+                  vis(currentX + 1, currentY - 1));
       } else if (j > i) {
         c_ = (double)(ls_.first - currentX + offset) /
              (currentY - ls_.second + offset);
-        v = visibility_(currentX, currentY - 1) -
-            c_ * (visibility_(currentX, currentY - 1) -
-                  visibility_(currentX + 1, currentY - 1));
+        v = vis(currentX, currentY - 1) -
+            c_ * (vis(currentX, currentY - 1) -
+                  vis(currentX + 1, currentY - 1));
       }
       v = v * occupancyComplement_->get(currentX, currentY);
-      visibility_(currentX, currentY) = v;
+      visibility_(currentX, currentY) = traits::fromDouble(v);
     }
   }
   // Q3
@@ -643,24 +1640,24 @@ void visibilityBasedSolver::computeVisibility() {
       if (i == 0 && j == 0) {
         v = lightStrength_;
       } else if (i == 0) {
-        v = visibility_(currentX, currentY + 1);
+        v = vis(currentX, currentY + 1);
       } else if (j == 0) {
-        v = visibility_(currentX + 1, currentY);
+        v = vis(currentX + 1, currentY);
       } else if (i > j) {
         c_ = (double)(ls_.second - currentY + offset) /
              (ls_.first - currentX + offset);
-        v = visibility_(currentX + 1, currentY) -
-            c_ * (visibility_(currentX + 1, currentY) -
-                  visibility_(currentX + 1, currentY + 1));
+        v = vis(currentX + 1, currentY) -
+            c_ * (vis(currentX + 1, currentY) -
+                  vis(currentX + 1, currentY + 1));
       } else if (j > i) {
         c_ = (double)(ls_.first - currentX + offset) /
              (ls_.second - currentY + offset);
-        v = visibility_(currentX, currentY + 1) -
-            c_ * (visibility_(currentX, currentY + 1) -
-                  visibility_(currentX + 1, currentY + 1));
+        v = vis(currentX, currentY + 1) -
+            c_ * (vis(currentX, currentY + 1) -
+                  vis(currentX + 1, currentY + 1));
       }
       v = v * occupancyComplement_->get(currentX, currentY);
-      visibility_(currentX, currentY) = v;
+      visibility_(currentX, currentY) = traits::fromDouble(v);
     }
   }
   // Q4
@@ -673,24 +1670,24 @@ void visibilityBasedSolver::computeVisibility() {
       if (i == 0 && j == 0) {
         v = lightStrength_;
       } else if (i == 0) {
-        v = visibility_(currentX, currentY + 1);
+        v = vis(currentX, currentY + 1);
       } else if (j == 0) {
-        v = visibility_(currentX - 1, currentY);
+        v = vis(currentX - 1, currentY);
       } else if (i > j) {
         c_ = (double)(ls_.second - currentY + offset) /
              (currentX - ls_.first + offset);
-        v = visibility_(currentX - 1, currentY) -
-            c_ * (visibility_(currentX - 1, currentY) -
-                  visibility_(currentX - 1, currentY + 1));
+        v = vis(currentX - 1, currentY) -
+            c_ * (vis(currentX - 1, currentY) -
+                  vis(currentX - 1, currentY + 1));
       } else if (j > i) {
         c_ = (double)(currentX - ls_.first + offset) /
              (ls_.second - currentY + offset);
-        v = visibility_(currentX, currentY + 1) -
-            c_ * (visibility_(currentX, currentY + 1) -
-                  visibility_(currentX - 1, currentY + 1));
+        v = vis(currentX, currentY + 1) -
+            c_ * (vis(currentX, currentY + 1) -
+                  vis(currentX - 1, currentY + 1));
       }
       v = v * occupancyComplement_->get(currentX, currentY);
-      visibility_(currentX, currentY) = v;
+      visibility_(currentX, currentY) = traits::fromDouble(v);
     }
   }
 }
@@ -698,214 +1695,115 @@ void visibilityBasedSolver::computeVisibility() {
 /*****************************************************************************/
 /*****************************************************************************/
 /*****************************************************************************/
-void visibilityBasedSolver::computeVisibilityUsingQueue() {
-  double v = 0.0;
-  point current;
+template <typename T>
+void visibilityBasedSolver<T>::computeVisibilityUsingQueue() {
+  if (!frontier_.resize(nx_, ny_)) {
+    std::cerr << "The frontier queue holds at most " << FrontierQueue::maxCells
+              << " cells, the grid has " << nx_ * ny_ << std::endl;
+    return;
+  }
+  frontier_.clear();
+  // Cells the frontier has not reached read as 0. Queued cells are zeroed on
+  // push, so the ones not processed yet read as 0 too.
+  auto vis = [this](size_t x, size_t y) {
+    return frontier_.isQueued(x, y) ? traits::toDouble(visibility_(x, y))
+                                    : 0.0;
+  };
+  auto push = [this](size_t x, size_t y) {
+    if (frontier_.push(x, y)) {
+      visibility_(x, y) = traits::fromDouble(0.0);
+    }
+  };
 
   const size_t ls_x = ls_.first;
   const size_t ls_y = ls_.second;
 
-  visibility_(ls_x, ls_y) = lightStrength_;
-  std::queue<point> q;
-  q.push({ls_x + 1, ls_y});
-  q.push({ls_x, ls_y + 1});
-  q.push({ls_x - 1, ls_y});
-  q.push({ls_x, ls_y - 1});
-  q.push({ls_x + 1, ls_y + 1});
-  q.push({ls_x - 1, ls_y + 1});
-  q.push({ls_x - 1, ls_y - 1});
-  q.push({ls_x + 1, ls_y - 1});
-
-  Field<bool> visited(nx_, ny_, false);
-
-  while (q.size() > 0) {
-    current = q.front();
-    const size_t x = current.first;
-    const size_t y = current.second;
-    q.pop();
-    if (!isValid(x, y)) {
-      continue;
-    }
-    if (visited.get(x, y)) {
-      continue;
-    }
+  // The source is reached but not processed
+  frontier_.push(ls_x, ls_y);
+  frontier_.pop();
+  visibility_(ls_x, ls_y) = traits::fromDouble(lightStrength_);
+  push(ls_x + 1, ls_y);
+  push(ls_x, ls_y + 1);
+  push(ls_x - 1, ls_y);
+  push(ls_x, ls_y - 1);
+  push(ls_x + 1, ls_y + 1);
+  push(ls_x - 1, ls_y + 1);
+  push(ls_x - 1, ls_y - 1);
+  push(ls_x + 1, ls_y - 1);
+
+  while (!frontier_.empty()) {
+    const size_t cell = frontier_.pop();
+    const size_t x = cell % nx_;
+    const size_t y = cell / nx_;
     if (occupancyComplement_->get(x, y) == 0) {
       continue;
     }
 
+    // Mirror the quadrant of the cell onto dx, dy >= 0: sx, sy step away from
+    // the light source and the transport reads the cells behind.
     const int dx = x - ls_x;
     const int dy = y - ls_y;
-
-    if (dx >= 0 && dy >= 0) {
-      if (dx == 0) {
-        v = visibility_(x, y - 1);
-        if (v > 0.001) {
-          q.push({x, y + 1});
-        }
-      } else if (dy == 0) {
-        v = visibility_(x - 1, y);
-        if (v > 0.001) {
-          q.push({x + 1, y});
-        }
-      } else if (dx == dy) {
-        v = visibility_(x - 1, y - 1);
-        if (v > 0.001) {
-          q.push({x, y + 1});
-          q.push({x + 1, y});
-          q.push({x + 1, y + 1});
-        }
-      } else if (dx > dy) {
-        c_ = (double)(dy) / (dx);
-        v = visibility_(x - 1, y) -
-            c_ * (visibility_(x - 1, y) - visibility_(x - 1, y - 1));
-        if (v > 0.001) {
-          q.push({x, y + 1});
-          q.push({x + 1, y});
-        }
-      } else if (dy > dx) {
-        c_ = (double)(dx) / (dy);
-        v = visibility_(x, y - 1) -
-            c_ * (visibility_(x, y - 1) - visibility_(x - 1, y - 1));
-        if (v > 0.001) {
-          q.push({x + 1, y});
-          q.push({x, y + 1});
-        }
+    const int sx = dx >= 0 ? 1 : -1;
+    const int sy = dy >= 0 ? 1 : -1;
+    const int ax = std::abs(dx);
+    const int ay = std::abs(dy);
+    const size_t bx = x - sx;
+    const size_t by = y - sy;
+
+    double v = 0.0;
+    if (ax == 0) {
+      v = vis(x, by);
+      if (v > queueCutoff) {
+        push(x, y + sy);
       }
-      v = v * occupancyComplement_->get(x, y);
-      visibility_(x, y) = v;
-      visited(x, y) = true;
-    } else if (dx < 0 && dy >= 0) {
-      if (dx == 0) {
-        v = visibility_(x, y - 1);
-        if (v > 0.001) {
-          q.push({x, y + 1});
-        }
-      } else if (dy == 0) {
-        v = visibility_(x + 1, y);
-        if (v > 0.001) {
-          q.push({x - 1, y});
-        }
-      } else if (-dx == dy) {
-        v = visibility_(x + 1, y - 1);
-        if (v > 0.001) {
-          q.push({x, y + 1});
-          q.push({x - 1, y});
-          q.push({x - 1, y + 1});
-        }
-      } else if (-dx > dy) {
-        c_ = (double)(dy) / (-dx);
-        v = visibility_(x + 1, y) -
-            c_ * (visibility_(x + 1, y) - visibility_(x + 1, y - 1));
-        if (v > 0.001) {
-          q.push({x, y + 1});
-          q.push({x - 1, y});
-        }
-      } else if (dy > -dx) {
-        c_ = (double)(-dx) / (dy);
-        v = visibility_(x, y - 1) -
-            c_ * (visibility_(x, y - 1) - visibility_(x + 1, y - 1));
-        if (v > 0.001) {
-          q.push({x - 1, y});
-          q.push({x, y + 1});
-        }
+    } else if (ay == 0) {
+      v = vis(bx, y);
+      if (v > queueCutoff) {
+        push(x + sx, y);
       }
-      v = v * occupancyComplement_->get(x, y);
-      visibility_(x, y) = v;
-      visited(x, y) = true;
-    } else if (dx < 0 && dy < 0) {
-      if (dx == 0) {
-        v = visibility_(x, y + 1);
-        if (v > 0.001) {
-          q.push({x, y - 1});
-        }
-      } else if (dy == 0) {
-        v = visibility_(x + 1, y);
-        if (v > 0.001) {
-          q.push({x - 1, y});
-        }
-      } else if (dx == dy) {
-        v = visibility_(x + 1, y + 1);
-        if (v > 0.001) {
-          q.push({x, y - 1});
-          q.push({x - 1, y});
-          q.push({x - 1, y - 1});
-        }
-      } else if (-dx > -dy) {
-        c_ = (double)(dy) / (dx);
-        v = visibility_(x + 1, y) -
-            c_ * (visibility_(x + 1, y) - visibility_(x + 1, y + 1));
-        if (v > 0.001) {
-          q.push({x, y - 1});
-          q.push({x - 1, y});
-        }
-      } else if (-dy > -dx) {
-        c_ = (double)(dx) / (dy);
-        v = visibility_(x, y + 1) -
-            c_ * (visibility_(x, y + 1) - visibility_(x + 1, y + 1));
-        if (v > 0.001) {
-          q.push({x - 1, y});
-          q.push({x, y - 1});
-        }
+    } else if (ax == ay) {
+      v = vis(bx, by);
+      if (v > queueCutoff) {
+        push(x, y + sy);
+        push(x + sx, y);
+        push(x + sx, y + sy);
       }
-      v = v * occupancyComplement_->get(x, y);
-      visibility_(x, y) = v;
-      visited(x, y) = true;
-    } else if (dx >= 0 && dy < 0) {
-      if (dx == 0) {
-        v = visibility_(x, y + 1);
-        if (v > 0.001) {
-          q.push({x, y - 1});
-        }
-      } else if (dy == 0) {
-        v = visibility_(x - 1, y);
-        if (v > 0.001) {
-          q.push({x + 1, y});
-        }
-      } else if (dx == -dy) {
-        v = visibility_(x - 1, y + 1);
-        if (v > 0.001) {
-          q.push({x, y - 1});
-          q.push({x + 1, y});
-          q.push({x + 1, y - 1});
-        }
-      } else if (dx > -dy) {
-        c_ = (double)(-dy) / (dx);
-        v = visibility_(x - 1, y) -
-            c_ * (visibility_(x - 1, y) - visibility_(x - 1, y + 1));
-        if (v > 0.001) {
-          q.push({x, y - 1});
-          q.push({x + 1, y});
-        }
-      } else if (-dy > dx) {
-        c_ = (double)(dx) / (-dy);
-        v = visibility_(x, y + 1) -
-            c_ * (visibility_(x, y + 1) - visibility_(x - 1, y + 1));
-        if (v > 0.001) {
-          q.push({x + 1, y});
-          q.push({x, y - 1});
-        }
+    } else if (ax > ay) {
+      const double c = (double)(ay) / (ax);
+      v = vis(bx, y) - c * (vis(bx, y) - vis(bx, by));
+      if (v > queueCutoff) {
+        push(x, y + sy);
+        push(x + sx, y);
+      }
+    } else {
+      const double c = (double)(ax) / (ay);
+      v = vis(x, by) - c * (vis(x, by) - vis(bx, by));
+      if (v > queueCutoff) {
+        push(x + sx, y);
+        push(x, y + sy);
       }
-      v = v * occupancyComplement_->get(x, y);
-      visibility_(x, y) = v;
-      visited(x, y) = true;
     }
+    visibility_(x, y) = traits::fromDouble(v);
   }
 }
 
 /*****************************************************************************/
 /*****************************************************************************/
 /*****************************************************************************/
-void visibilityBasedSolver::saveStandAloneVisibility() const {
-  sf::Image image;
-  image = *uniqueLoadedImage_;
-  sf::Color color;
+template <typename T>
+void visibilityBasedSolver<T>::saveStandAloneVisibility() const {
+  // Every row but the bottom one is drawn over
+  Image image;
+  image.create(nx_, ny_, Color::Black);
+  Color color;
   color.a = 1;
 
   for (size_t j = ny_ - 1; j > 0; --j) {
     for (size_t i = 0; i < nx_; ++i) {
       image.setPixel(i, ny_ - 1 - j,
-                     sf::Color(255 * visibility_(i, j), 255 * visibility_(i, j),
-                               255 * visibility_(i, j)));
+                     Color(255 * traits::toDouble(visibility_(i, j)),
+                               255 * traits::toDouble(visibility_(i, j)),
+                               255 * traits::toDouble(visibility_(i, j))));
       // use this for binary visibility
       // if (visibility_(i, j) < visibilityThreshold_) {
       //   image.setPixel(i, ny_ - 1 - j, color.Black);
@@ -951,22 +1849,24 @@ void visibilityBasedSolver::saveStandAloneVisibility() const {
   }
 
   const std::string imageName = "output/standAloneVisibility.png";
-  image.saveToFile(imageName);
+  saveImage(image, imageName);
 }
 
 /*****************************************************************************/
 /*****************************************************************************/
 /*****************************************************************************/
-void visibilityBasedSolver::saveRayCastingVisibility() const {
-  sf::Image image;
-  image = *uniqueLoadedImage_;
-  sf::Color color;
+template <typename T>
+void visibilityBasedSolver<T>::saveRayCastingVisibility() const {
+  // Every row but the bottom one is drawn over
+  Image image;
+  image.create(nx_, ny_, Color::Black);
+  Color color;
   color.a = 1;
 
   for (size_t j = ny_ - 1; j > 0; --j) {
     for (size_t i = 0; i < nx_; ++i) {
       image.setPixel(i, ny_ - 1 - j,
-                     sf::Color(255 * visibilityRayCasting_.get(i, j),
+                     Color(255 * visibilityRayCasting_.get(i, j),
                                255 * visibilityRayCasting_.get(i, j),
                                255 * visibilityRayCasting_.get(i, j)));
       // use this for binary visibility
@@ -1013,13 +1913,42 @@ void visibilityBasedSolver::saveRayCastingVisibility() const {
   }
 
   const std::string imageName = "output/rayCastingVisibility.png";
-  image.saveToFile(imageName);
+  saveImage(image, imageName);
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+template <typename T>
+void visibilityBasedSolver<T>::saveResults() const {
+  auto results = std::make_shared<Results>();
+  if (sharedConfig_->saveCameFrom) {
+    results->cameFrom.assign(cameFrom_);
+  }
+  if (sharedConfig_->saveLightSources) {
+    results->lightSources.assign(lightSources_.begin(),
+                                 lightSources_.begin() + nb_of_sources_);
+  }
+  if (sharedConfig_->timer) {
+    results->iterationTimings = iterationTimings_;
+  }
+  if (sharedConfig_->saveGlobalVisibility) {
+    results->visibilityGlobal.assign(visibility_global_);
+  }
+  if (sharedConfig_->saveLocalVisibility) {
+    results->visibility.assign(visibility_);
+  }
+  if (sharedConfig_->saveVisibilityField) {
+    results->occupancy.assign(*occupancyComplement_);
+  }
+  writer_->submit([this, results] { writeResults(*results); });
 }
 
 /*****************************************************************************/
 /*****************************************************************************/
 /*****************************************************************************/
-void visibilityBasedSolver::saveResults() const {
+template <typename T>
+void visibilityBasedSolver<T>::writeResults(const Results &results) const {
   namespace fs = std::filesystem;
   // Define the path to the output file
   std::string path = "./output/cameFrom.txt";
@@ -1031,32 +1960,18 @@ void visibilityBasedSolver::saveResults() const {
       return;
     }
   }
+  // Grids are written in bulk as .npy or one value at a time as text, with
+  // the rows flipped back to image order in image mode
+  const auto format = static_cast<OutputFormat>(sharedConfig_->outputFormat);
+  const bool flip = sharedConfig_->mode == 2;
 
   if (sharedConfig_->saveCameFrom) {
-    std::fstream of(path, std::ios::out | std::ios::trunc);
-    if (!of.is_open()) {
-      std::cerr << "Failed to open output file " << path << std::endl;
+    if (!writeGrid<size_t>("./output/cameFrom", format, nx_, ny_, flip,
+                           [&](size_t x, size_t y) {
+                             return results.cameFrom(x, y);
+                           })) {
       return;
     }
-    if (of.is_open()) {
-      std::ostream &os = of;
-      if (sharedConfig_->mode == 2) {
-        for (int j = ny_ - 1; j >= 0; --j) {
-          for (size_t i = 0; i < nx_; ++i) {
-            os << cameFrom_(i, j) << " ";
-          }
-          os << "\n";
-        }
-      } else {
-        for (size_t j = 0; j < ny_; ++j) {
-          for (size_t i = 0; i < nx_; ++i) {
-            os << cameFrom_(i, j) << " ";
-          }
-          os << "\n";
-        }
-      }
-      of.close();
-    }
     if (!sharedConfig_->silent) {
       std::cout << "Saved cameFrom_" << std::endl;
     }
@@ -1070,12 +1985,11 @@ void visibilityBasedSolver::saveResults() const {
     }
     if (of.is_open()) {
       std::ostream &os = of;
-      for (size_t i = 0; i < nb_of_sources_; ++i) {
+      for (const point &source : results.lightSources) {
         if (sharedConfig_->mode == 2) {
-          os << lightSources_[i].first << " "
-             << ny_ - 1 - lightSources_[i].second;
+          os << source.first << " " << ny_ - 1 - source.second;
         } else {
-          os << lightSources_[i].first << " " << lightSources_[i].second;
+          os << source.first << " " << source.second;
         }
         os << "\n";
       }
@@ -1085,92 +1999,57 @@ void visibilityBasedSolver::saveResults() const {
       std::cout << "Saved lightSources" << std::endl;
     }
   }
-  if (sharedConfig_->saveGlobalVisibility) {
-    path = "./output/VisibilityMap.txt";
+  if (sharedConfig_->timer) {
+    // One line per iteration: reset, sweep and pivot selection times in us,
+    // then the number of changed candidates, of rescanned tiles and of scored
+    // candidates
+    path = "./output/iterationTimings.txt";
     std::fstream of(path, std::ios::out | std::ios::trunc);
     if (!of.is_open()) {
       std::cerr << "Failed to open output file " << path << std::endl;
       return;
     }
-    if (of.is_open()) {
-      std::ostream &os = of;
-      if (sharedConfig_->mode == 2) {
-        for (int j = ny_ - 1; j >= 0; --j) {
-          for (size_t i = 0; i < nx_; ++i) {
-            os << visibility_global_(i, j) << " ";
-          }
-          os << "\n";
-        }
-      } else {
-        for (size_t j = 0; j < ny_; ++j) {
-          for (size_t i = 0; i < nx_; ++i) {
-            os << visibility_global_(i, j) << " ";
-          }
-          os << "\n";
-        }
-      }
-      of.close();
+    std::ostream &os = of;
+    for (const auto &timing : results.iterationTimings) {
+      os << timing.reset << " " << timing.sweep << " " << timing.select << " "
+         << timing.changed << " " << timing.rescans << " " << timing.scored
+         << "\n";
+    }
+    of.close();
+    if (!sharedConfig_->silent) {
+      std::cout << "Saved iterationTimings" << std::endl;
+    }
+  }
+  if (sharedConfig_->saveGlobalVisibility) {
+    if (!writeGrid<double>("./output/VisibilityMap", format, nx_, ny_, flip,
+                           [&](size_t x, size_t y) {
+                             return traits::toDouble(
+                                 results.visibilityGlobal(x, y));
+                           })) {
+      return;
     }
     if (!sharedConfig_->silent) {
       std::cout << "Saved GlobalVisibility" << std::endl;
     }
   }
   if (sharedConfig_->saveLocalVisibility) {
-    path = "./output/LocalVisibilityMap.txt";
-    std::fstream of(path, std::ios::out | std::ios::trunc);
-    if (!of.is_open()) {
-      std::cerr << "Failed to open output file " << path << std::endl;
+    if (!writeGrid<double>("./output/LocalVisibilityMap", format, nx_, ny_,
+                           flip, [&](size_t x, size_t y) {
+                             return traits::toDouble(results.visibility(x, y));
+                           })) {
       return;
     }
-    if (of.is_open()) {
-      std::ostream &os = of;
-      if (sharedConfig_->mode == 2) {
-        for (int j = ny_ - 1; j >= 0; --j) {
-          for (size_t i = 0; i < nx_; ++i) {
-            os << visibility_(i, j) << " ";
-          }
-          os << "\n";
-        }
-      } else {
-        for (size_t j = 0; j < ny_; ++j) {
-          for (size_t i = 0; i < nx_; ++i) {
-            os << visibility_(i, j) << " ";
-          }
-          os << "\n";
-        }
-      }
-      of.close();
-    }
     if (!sharedConfig_->silent) {
       std::cout << "Saved LocalVisibility" << std::endl;
     }
   }
   if (sharedConfig_->saveVisibilityField) {
-    path = "./output/visibilityField.txt";
-    std::fstream of(path, std::ios::out | std::ios::trunc);
-    if (!of.is_open()) {
-      std::cerr << "Failed to open output file " << path << std::endl;
+    if (!writeGrid<bool>("./output/visibilityField", format, nx_, ny_, flip,
+                         [&](size_t x, size_t y) {
+                           return results.occupancy.get(x, y);
+                         })) {
       return;
     }
-    if (of.is_open()) {
-      std::ostream &os = of;
-      if (sharedConfig_->mode == 2) {
-        for (int j = ny_ - 1; j >= 0; --j) {
-          for (size_t i = 0; i < nx_; ++i) {
-            os << occupancyComplement_->get(i, j) << " ";
-          }
-          os << "\n";
-        }
-      } else {
-        for (size_t j = 0; j < ny_; ++j) {
-          for (size_t i = 0; i < nx_; ++i) {
-            os << occupancyComplement_->get(i, j) << " ";
-          }
-          os << "\n";
-        }
-      }
-      of.close();
-    }
     if (!sharedConfig_->silent) {
       std::cout << "Saved OccupancyComplement" << std::endl;
     }
@@ -1180,9 +2059,34 @@ void visibilityBasedSolver::saveResults() const {
 /*****************************************************************************/
 /*****************************************************************************/
 /*****************************************************************************/
-void visibilityBasedSolver::reconstructPath(const Node &current,
-                                            std::vector<point> &resultingPath) {
-  int x = current.x, y = current.y;
+template <typename T>
+void visibilityBasedSolver<T>::reconstructPath(
+    const Node &current, std::vector<point> &resultingPath) {
+  const double totalDistance = tracePath(
+      {static_cast<int>(current.x), static_cast<int>(current.y)},
+      resultingPath);
+  if (!sharedConfig_->silent) {
+    std::cout << "Path length: " << totalDistance << std::endl;
+  }
+
+  if (sharedConfig_->saveResults) {
+    // The map is copied with the path, cells may change while it is drawn
+    auto occupancy = std::make_shared<OccupancyGrid>();
+    occupancy->assign(*occupancyComplement_);
+    writer_->submit([this, resultingPath, occupancy] {
+      saveImageWithPath(resultingPath, *occupancy);
+    });
+  }
+  return;
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+template <typename T>
+double visibilityBasedSolver<T>::tracePath(const point &goal,
+                                           std::vector<point> &resultingPath) {
+  int x = goal.first, y = goal.second;
   double t = cameFrom_(x, y);
   double t_old = std::numeric_limits<double>::max();
   while (t != t_old) {
@@ -1202,24 +2106,17 @@ void visibilityBasedSolver::reconstructPath(const Node &current,
         eval_d(resultingPath[i].first, resultingPath[i].second,
                resultingPath[i + 1].first, resultingPath[i + 1].second);
   }
-  if (!sharedConfig_->silent) {
-    std::cout << "Path length: " << totalDistance << std::endl;
-  }
-
-  if (sharedConfig_->saveResults) {
-    saveImageWithPath(resultingPath);
-  }
-  return;
+  return totalDistance;
 }
 
 /*****************************************************************************/
 /*****************************************************************************/
 /*****************************************************************************/
-void visibilityBasedSolver::saveImageWithPath(
-    const std::vector<point> &path) const {
-  sf::Image image;
-  image = *uniqueLoadedImage_;
-  sf::Color color;
+template <typename T>
+void visibilityBasedSolver<T>::saveImageWithPath(
+    const std::vector<point> &path, const OccupancyGrid &occupancy) const {
+  Image image = occupancyImage(occupancy);
+  Color color;
   color.a = 1;
   int x0, y0, x1, y1;
   int dx, dy, sx, sy, err;
@@ -1288,7 +2185,11 @@ void visibilityBasedSolver::saveImageWithPath(
     }
   }
   const std::string imageName = "output/ResultingPath.png";
-  image.saveToFile(imageName);
+  saveImage(image, imageName);
 }
 
+template class visibilityBasedSolver<double>;
+template class visibilityBasedSolver<float>;
+template class visibilityBasedSolver<fixed16>;
+
 } // namespace vbs
@@ -0,0 +1,110 @@
+// Visibility repaired after cells of the environment changed, against the
+// visibility computed from scratch on the changed environment. Covers full
+// and directional sources, with and without a limited range.
+
+#include "environment/environment.h"
+#include "solver/visibilityBasedSolver.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <numbers>
+#include <vector>
+
+namespace {
+
+using vbs::point;
+
+// Light source and sector of one case, an aperture of 0 for every direction
+struct RepairCase {
+  const char *name;
+  double heading;
+  double aperture;
+  double radius;
+};
+
+/*!
+ * @brief Compute the visibility of a source, block cells in front of it,
+ * repair the visibility and compare it with a fresh computation.
+ * @param [in] config Configuration of the environment and solver.
+ * @param [in] c Case to run.
+ * @return true if the repaired and the fresh visibility are equal.
+ */
+bool repairRun(vbs::Config config, const RepairCase &c) {
+  vbs::environment env(config);
+  vbs::visibilityBasedSolver<double> solver(env);
+  solver.setRange(c.radius);
+  const auto &occupancy = env.getVisibilityField();
+
+  // First free cell from the center of the grid
+  point source{static_cast<int>(config.ncols / 2),
+               static_cast<int>(config.nrows / 2)};
+  while (!occupancy->get(source.first, source.second)) {
+    ++source.first;
+  }
+  auto compute = [&]() {
+    if (c.aperture > 0) {
+      solver.computeVisibility(source, c.heading, c.aperture);
+    } else {
+      solver.computeVisibility(source);
+    }
+  };
+
+  // Two cells in front of the source and one behind it
+  std::vector<vbs::CellUpdate> updates;
+  for (const double d : {20.0, 35.0, -25.0}) {
+    const double x = source.first + d * std::cos(c.heading);
+    const double y = source.second + d * std::sin(c.heading);
+    updates.push_back({static_cast<size_t>(std::lround(x)),
+                       static_cast<size_t>(std::lround(y)), false});
+  }
+
+  compute();
+  env.updateCells(updates);
+  solver.repairVisibility(updates);
+  const std::vector<double> repaired(
+      solver.getVisibility().data(),
+      solver.getVisibility().data() + solver.getVisibility().size());
+  compute();
+  const vbs::Field<double> &fresh = solver.getVisibility();
+
+  size_t differences = 0;
+  for (size_t k = 0; k < fresh.size(); ++k) {
+    differences += repaired[k] != fresh.data()[k];
+  }
+  std::cout << c.name << ": " << differences
+            << " cells differ from a fresh computation" << std::endl;
+  return differences == 0;
+}
+
+} // namespace
+
+int main() {
+  vbs::Config config;
+  config.mode = 1;
+  config.ncols = 400;
+  config.nrows = 400;
+  config.nb_of_obstacles = 12;
+  config.minWidth = 20;
+  config.maxWidth = 60;
+  config.minHeight = 20;
+  config.maxHeight = 60;
+  config.randomSeed = false;
+  config.seedValue = 25;
+  config.threads = 2;
+  config.timer = false;
+  config.saveResults = false;
+  config.silent = true;
+
+  constexpr double pi = std::numbers::pi;
+  const RepairCase cases[] = {{"every direction", 0.3, 0, 0},
+                              {"every direction, ranged", 0.3, 0, 120},
+                              {"90 degree sector", 0.3, pi / 2, 0},
+                              {"270 degree sector", 2.0, 1.5 * pi, 0},
+                              {"90 degree sector, ranged", 4.0, pi / 2, 120}};
+  bool passed = true;
+  for (const auto &c : cases) {
+    passed &= repairRun(config, c);
+  }
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,158 @@
+// Resident solver answering a stream of queries, the way the planning server
+// and libvbs use it. Global operator new, plain and aligned, is replaced by
+// a counting one: once the solver has seen the queries, solving them again
+// must allocate nothing.
+
+#include "environment/environment.h"
+#include "solver/visibilityBasedSolver.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <vector>
+
+namespace {
+
+std::atomic<std::size_t> allocations{0};
+
+} // namespace
+
+void *operator new(std::size_t size) {
+  ++allocations;
+  if (void *p = std::malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+void *operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+// Fields allocate through std::pmr::new_delete_resource() with the alignment
+// of a cache line, which lands here
+void *operator new(std::size_t size, std::align_val_t alignment) {
+  ++allocations;
+  const std::size_t align = static_cast<std::size_t>(alignment);
+  const std::size_t rounded =
+      (std::max(size, align) + align - 1) / align * align;
+  if (void *p = std::aligned_alloc(align, rounded)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+  return operator new(size, alignment);
+}
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+namespace {
+
+using vbs::point;
+
+// Queries of every run
+constexpr int queries = 20;
+
+/*!
+ * @brief Solve the same queries twice on one solver and count the
+ * allocations of the second round.
+ * @param [in] name Name of the run, printed with its result.
+ * @param [in] config Configuration of the environment and solver.
+ * @return true if the second round allocated nothing.
+ */
+bool residentRun(const char *name, vbs::Config config) {
+  vbs::environment env(config);
+  vbs::visibilityBasedSolver<double> solver(env);
+  const auto &occupancy = env.getVisibilityField();
+
+  std::mt19937 generator(7);
+  auto freeCell = [&]() {
+    while (true) {
+      const int x = generator() % occupancy->nx();
+      const int y = generator() % occupancy->ny();
+      if (occupancy->get(x, y)) {
+        return point{x, y};
+      }
+    }
+  };
+  std::vector<std::pair<point, point>> pairs;
+  for (int i = 0; i < queries; ++i) {
+    const point start = freeCell();
+    pairs.push_back({start, freeCell()});
+  }
+
+  std::vector<point> path;
+  path.reserve(config.max_iter + 2);
+  double warmLength = 0;
+  for (const auto &[start, goal] : pairs) {
+    warmLength += solver.solve(start, goal, path);
+  }
+  const std::size_t before = allocations;
+  double length = 0;
+  for (const auto &[start, goal] : pairs) {
+    length += solver.solve(start, goal, path);
+  }
+  const std::size_t count = allocations - before;
+
+  std::cout << name << ": " << count << " allocations in " << queries
+            << " warm solves" << std::endl;
+  if (length != warmLength) {
+    std::cerr << name << ": warm solves differ from the first ones"
+              << std::endl;
+    return false;
+  }
+  return count == 0;
+}
+
+} // namespace
+
+int main() {
+  // The storage of a field must be counted, or regrown grids would go unseen
+  const std::size_t before = allocations;
+  { const vbs::Field<double> field(64, 64, 0.0); }
+  if (allocations == before) {
+    std::cerr << "The allocation of a field was not counted" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vbs::Config config;
+  config.mode = 1;
+  config.ncols = 300;
+  config.nrows = 300;
+  config.nb_of_obstacles = 12;
+  config.minWidth = 20;
+  config.maxWidth = 60;
+  config.minHeight = 20;
+  config.maxHeight = 60;
+  config.randomSeed = false;
+  config.seedValue = 25;
+  config.max_iter = 250;
+  config.visibilityThreshold = 0.25;
+  config.threads = 2;
+  config.timer = false;
+  config.saveResults = false;
+  config.silent = true;
+
+  bool passed = residentRun("every cell", config);
+
+  vbs::Config corners = config;
+  corners.cornerPivots = true;
+  passed &= residentRun("corner pivots", corners);
+
+  vbs::Config ranged = config;
+  ranged.visibilityRadius = 80;
+  passed &= residentRun("visibility radius", ranged);
+
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}